@@ -18,6 +18,7 @@
 
 #include <fmt/format.h>
 #include "Share.h"
+#include "circuit_file.h"
 #include "../math.h"
 #include "../util.h"
 
@@ -50,7 +51,7 @@ BoolShare apply_file_binary(const BoolShare& a, const BoolShare& b,
   copy_n(begin(a_wires), a_bits, back_inserter(in));
   copy_n(begin(b_wires), b_bits, back_inserter(in));
 
-  return BoolShare{a.bcirc, a.bcirc->PutGateFromFile(fn, in, a.get_nvals())};
+  return BoolShare{a.bcirc, CircuitFile::get(fn).apply(a.bcirc, in, a.get_nvals())};
 }
 
 vector<BoolShare> BoolShare::split(uint32_t new_nval) const {
@@ -106,19 +107,59 @@ BoolShare BoolShare::zeropad(uint32_t bitlen) const {
   return BoolShare{bcirc, wires};
 }
 
+BoolShare BoolShare::with_bitlength(uint32_t bitlen) const {
+  if (get_bitlen() < bitlen) return zeropad(bitlen);
+
+  vector<uint32_t> wires(sh->get_wires());
+  wires.resize(bitlen);
+  return BoolShare{bcirc, wires};
+}
+
+namespace {
+/**
+ * ABY reads arithmetic input values as elements of its ring type. So if the
+ * ring is narrower than 32 bits, the values are packed into a buffer of
+ * matching type, which is passed on to put.
+ */
+template <typename PutF>
+share* put_ring_values(uint32_t* values, uint32_t bitlen, uint32_t nvals,
+    PutF&& put) {
+  if (bitlen <= 8) {
+    vector<uint8_t> packed(values, values + nvals);
+    return put(packed.data());
+  } else if (bitlen <= 16) {
+    vector<uint16_t> packed(values, values + nvals);
+    return put(packed.data());
+  }
+  return put(values);
+}
+} // namespace
+
+ArithShare::ArithShare(ArithmeticCircuit* ac, uint32_t* values, uint32_t bitlen,
+    e_role role, uint32_t nvals) :
+  ArithShare{ac, put_ring_values(values, bitlen, nvals, [&](auto vals) {
+        return ac->PutSIMDINGate(nvals, vals, bitlen, role); })} {}
+
 /******************** OutShare ********************/
 
 vector<uint32_t> OutShare::get_clear_value_vec() {
   uint32_t* arr;
   uint32_t nvals, bitlen;
   sh->get_clear_value_vec(&arr, &bitlen, &nvals);
-  assert(bitlen == 32); // TODO <= 32
+  assert(bitlen <= 32);
 
   vector<uint32_t> vec(arr, arr+nvals);
 
   return vec;
 }
 
+vector<uint8_t> OutShare::get_clear_value_bytes() {
+  const size_t size = bitbytes(get_bitlen()) * get_nvals();
+  const uint8_t* arr = sh->get_clear_value_ptr();
+
+  return vector<uint8_t>(arr, arr+size);
+}
+
 /******************** Factories ********************/
 
 OutShare out(const Share& share, e_role dst) {
@@ -131,6 +172,15 @@ OutShare out_shared(const Share& share) {
       share.get_circuit()->PutSharedOUTGate(share.get()));
 }
 
+BoolShare shared_in(BooleanCircuit* c, uint8_t* values, uint32_t bitlen, uint32_t nvals) {
+  return BoolShare{c, c->PutSharedSIMDINGate(nvals, values, bitlen)};
+}
+
+ArithShare shared_in(ArithmeticCircuit* c, uint32_t* values, uint32_t bitlen, uint32_t nvals) {
+  return ArithShare{c, put_ring_values(values, bitlen, nvals, [&](auto vals) {
+        return c->PutSharedSIMDINGate(nvals, vals, bitlen); })};
+}
+
 OutShare print_share(const Share& share, const string& msg) {
   string desc = fmt::format("({},{} {}) ",
       share.get_bitlen(), share.get_nvals(), msg);
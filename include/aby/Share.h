@@ -267,6 +267,13 @@ class BoolShare: public Share {
    */
   BoolShare zeropad(uint32_t bitlen) const;
 
+  /**
+   * Returns this share truncated or zeropadded to given bitlen. Unlike
+   * set_bitlength(), this creates a new share and leaves copies of this share
+   * untouched.
+   */
+  BoolShare with_bitlength(uint32_t bitlen) const;
+
   friend BoolShare hammingweight(const BoolShare& s) {
     return BoolShare{s.bcirc, s.bcirc->PutHammingWeightGate(s.get())};
   }
@@ -274,6 +281,7 @@ class BoolShare: public Share {
   /**
    * Run circuit specification from given file path and inputs.
    * Only the specified bits will be used.
+   * The file is only read and parsed on first use, see CircuitFile.
    */
   friend BoolShare apply_file_binary(const BoolShare& a, const BoolShare& b,
       uint32_t a_bits, uint32_t b_bits, const std::string& fn);
@@ -320,6 +328,12 @@ class ArithShare: public Share {
   ArithShare(ArithmeticCircuit* ac, T value, uint32_t bitlen, e_role role, uint32_t nvals) :
     Share{static_cast<Circuit*>(ac), value, bitlen, role, nvals}, acirc{ac} {}
 
+  /*
+   * SIMDINGate from 32-bit values, which are packed to the ring bitlen first
+   */
+  ArithShare(ArithmeticCircuit* ac, uint32_t* values, uint32_t bitlen, e_role role,
+      uint32_t nvals);
+
   /*
    * DummyInGate
    */
@@ -343,6 +357,7 @@ class ArithShare: public Share {
 
 class OutShare: private Share {
   public:
+  OutShare() = default;
   OutShare(Circuit* circ, share* sh) : Share{circ, sh} {}
 
   template<typename T>
@@ -352,6 +367,12 @@ class OutShare: private Share {
   }
 
   std::vector<uint32_t> get_clear_value_vec();
+
+  /**
+   * Clear values of a boolean SIMD share of arbitrary bitlen, each value
+   * occupying ceil(bitlen/8) bytes, as expected by SIMD IN gates.
+   */
+  std::vector<uint8_t> get_clear_value_bytes();
 };
 
 /******************** Factories ********************/
@@ -368,6 +389,14 @@ OutShare out(const Share& share, e_role dst);
  */
 OutShare out_shared(const Share& share);
 
+/*
+ * SharedINGate factories
+ * Each party inputs its own share of the underlying values, e.g., as obtained
+ * from a previous out_shared(). Only supported for GMW and arithmetic shares.
+ */
+BoolShare shared_in(BooleanCircuit* c, uint8_t* values, uint32_t bitlen, uint32_t nvals);
+ArithShare shared_in(ArithmeticCircuit* c, uint32_t* values, uint32_t bitlen, uint32_t nvals);
+
 /*
  * Debugging PrintValueGate
  */
@@ -0,0 +1,151 @@
+/**
+ \file    sel/aby/circuit_file.cpp
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief In-memory cache of boolean circuits in ABY's circuit file format
+*/
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <fmt/format.h>
+#include "circuit_file.h"
+#include "abycore/circuit/booleancircuits.h"
+
+using namespace std;
+
+namespace sel {
+
+const CircuitFile& CircuitFile::get(const string& filename) {
+  static mutex cache_mutex;
+  static map<string, unique_ptr<const CircuitFile>> cache;
+
+  lock_guard<mutex> lock(cache_mutex);
+  auto& circ = cache[filename];
+  if (!circ) circ.reset(new CircuitFile(filename));
+  return *circ;
+}
+
+CircuitFile::CircuitFile(const string& filename) {
+  ifstream file(filename);
+  if (!file.is_open()) {
+    throw runtime_error(fmt::format("Cannot open circuit file {}", filename));
+  }
+
+  // maps file wire ids to consecutive wire indices
+  map<int64_t, uint32_t> wire_index;
+  const auto wire = [this, &wire_index](int64_t id) {
+    auto [it, inserted] = wire_index.try_emplace(id, num_wires);
+    if (inserted) ++num_wires;
+    return it->second;
+  };
+
+  string line;
+  vector<int64_t> ids;
+  while (getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+
+    ids.clear();
+    istringstream tokens(line.substr(1));
+    for (int64_t id; tokens >> id;) ids.push_back(id);
+
+    const char type = line[0];
+    const auto check_ids = [&](size_t n) {
+      if (ids.size() != n) {
+        throw runtime_error(fmt::format(
+              "Malformed gate '{}' in circuit file {}", line, filename));
+      }
+    };
+    switch (type) {
+      case 'C': // fallthrough, inputs are assigned in order of appearance
+      case 'S':
+        for (auto id : ids) inputs.push_back(wire(id));
+        break;
+      case 'O':
+        for (auto id : ids) outputs.push_back(wire(id));
+        break;
+      case '0': // fallthrough
+      case '1':
+        check_ids(1);
+        gates.push_back({Op(type), 0, 0, 0, wire(ids[0])});
+        break;
+      case 'I':
+        check_ids(2);
+        gates.push_back({Op::INV, wire(ids[0]), 0, 0, wire(ids[1])});
+        break;
+      case 'A': // fallthrough
+      case 'X':
+      case 'V':
+        check_ids(3);
+        gates.push_back({Op(type), wire(ids[0]), wire(ids[1]), 0, wire(ids[2])});
+        break;
+      case 'M':
+        check_ids(4);
+        gates.push_back({Op::MUX, wire(ids[0]), wire(ids[1]), wire(ids[2]),
+            wire(ids[3])});
+        break;
+      default:
+        throw runtime_error(fmt::format(
+              "Unknown gate type '{}' in circuit file {}", type, filename));
+    }
+  }
+}
+
+vector<uint32_t> CircuitFile::apply(BooleanCircuit* bcirc,
+    const vector<uint32_t>& in, uint32_t nvals) const {
+  if (in.size() < inputs.size()) {
+    throw invalid_argument(fmt::format(
+          "Circuit file needs {} input wires but only {} were given.",
+          inputs.size(), in.size()));
+  }
+
+  vector<uint32_t> wires(num_wires);
+  for (size_t i = 0; i != inputs.size(); ++i) wires[inputs[i]] = in[i];
+
+  for (const auto& g : gates) {
+    switch (g.op) {
+      case Op::ZERO:
+        wires[g.out] = bcirc->PutConstantGate(0, nvals);
+        break;
+      case Op::ONE:
+        wires[g.out] = bcirc->PutConstantGate(1, nvals);
+        break;
+      case Op::AND:
+        wires[g.out] = bcirc->PutANDGate(wires[g.a], wires[g.b]);
+        break;
+      case Op::XOR:
+        wires[g.out] = bcirc->PutXORGate(wires[g.a], wires[g.b]);
+        break;
+      case Op::OR:
+        wires[g.out] = bcirc->PutORGate(wires[g.a], wires[g.b]);
+        break;
+      case Op::INV:
+        wires[g.out] = bcirc->PutINVGate(wires[g.a]);
+        break;
+      case Op::MUX:
+        wires[g.out] = bcirc->PutMUXGate({wires[g.a]}, {wires[g.b]}, wires[g.s])[0];
+        break;
+    }
+  }
+
+  vector<uint32_t> out;
+  out.reserve(outputs.size());
+  for (auto o : outputs) out.push_back(wires[o]);
+  return out;
+}
+
+} // namespace sel
@@ -0,0 +1,78 @@
+/**
+ \file    sel/aby/circuit_file.h
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief In-memory cache of boolean circuits in ABY's circuit file format
+*/
+
+#ifndef SEL_ABY_CIRCUIT_FILE_H
+#define SEL_ABY_CIRCUIT_FILE_H
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// forward declarations
+class BooleanCircuit;
+
+namespace sel {
+
+/**
+ * Boolean circuit in the file format read by ABY's
+ * BooleanCircuit::PutGateFromFile(), parsed once and kept in memory.
+ *
+ * Wire ids of the file are remapped to consecutive indices during parsing, so
+ * that instantiating the circuit only needs to put the gates.
+ * Supports the gate types 0, 1, A, X, V, I and M (MUX), other types are
+ * rejected with an exception during parsing.
+ */
+class CircuitFile {
+public:
+  /**
+   * Returns the parsed circuit of given file path from the process-wide cache.
+   * The file is read and parsed on first access. Thread-safe.
+   */
+  static const CircuitFile& get(const std::string& filename);
+
+  /**
+   * Puts the gates of this circuit on the given inputs into bcirc and returns
+   * the output wires. Like PutGateFromFile(), inputs are assigned to the input
+   * wires in the order they appear in the file.
+   */
+  std::vector<uint32_t> apply(BooleanCircuit* bcirc,
+      const std::vector<uint32_t>& inputs, uint32_t nvals) const;
+
+  size_t num_inputs() const { return inputs.size(); }
+  size_t num_outputs() const { return outputs.size(); }
+
+private:
+  enum class Op : char {
+    ZERO = '0', ONE = '1', AND = 'A', XOR = 'X', OR = 'V', INV = 'I',
+    MUX = 'M'
+  };
+  // MUX gates select a if s is set, else b, like PutMUXGate()
+  struct Gate { Op op; uint32_t a, b, s, out; };
+
+  size_t num_wires{0};
+  std::vector<uint32_t> inputs;
+  std::vector<Gate> gates;
+  std::vector<uint32_t> outputs;
+
+  explicit CircuitFile(const std::string& filename);
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_ABY_CIRCUIT_FILE_H */
@@ -0,0 +1,101 @@
+/**
+ \file    sel/aby/cost_model.cpp
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Runtime prediction of ABY circuits from gate statistics
+*/
+
+#include <cassert>
+#include <cmath>
+#include "abycore/aby/abyparty.h"
+#include "abycore/circuit/arithmeticcircuits.h"
+#include "abycore/circuit/booleancircuits.h"
+#include "abycore/sharing/sharing.h"
+#include "cost_model.h"
+#include "../math.h"
+
+using namespace std;
+
+namespace sel::aby {
+
+// Bytes of the symmetric security parameter, i.e., of a wire label or an
+// OT extension matrix column
+constexpr double KAPPA_BYTES = 16;
+
+CircuitStats read_circuit_stats(ABYParty& party) {
+  const auto sharings = party.GetSharings();
+  auto ac = (ArithmeticCircuit*) sharings[S_ARITH]->GetCircuitBuildRoutine();
+  auto bc = (BooleanCircuit*) sharings[S_BOOL]->GetCircuitBuildRoutine();
+  auto yc = (BooleanCircuit*) sharings[S_YAO]->GetCircuitBuildRoutine();
+
+  CircuitStats stats;
+  stats.gmw_and = bc->GetNumANDGates();
+  stats.yao_and = yc->GetNumANDGates();
+  stats.arith_mul = ac->GetNumMULGates();
+  stats.b2a = ac->GetNumCONVGates();
+  stats.a2y = yc->GetNumA2YGates();
+  stats.b2y = yc->GetNumB2YGates();
+  stats.depth = party.GetTotalDepth();
+  return stats;
+}
+
+CircuitStats extrapolate_circuit_stats(const CircuitStats& ref,
+    const CircuitStats& ref2, size_t ref_size, size_t num_records, size_t size) {
+  assert (ref_size && (ref_size & (ref_size - 1)) == 0);
+  const auto gates = [&](uint64_t at_ref, uint64_t at_ref2) {
+    const double slope = (static_cast<double>(at_ref2) - at_ref) / ref_size;
+    const double per_record = at_ref + slope * (static_cast<double>(size) - ref_size);
+    return static_cast<uint64_t>(llround(max(0., num_records * per_record)));
+  };
+  CircuitStats stats;
+  stats.gmw_and = gates(ref.gmw_and, ref2.gmw_and);
+  stats.yao_and = gates(ref.yao_and, ref2.yao_and);
+  stats.arith_mul = gates(ref.arith_mul, ref2.arith_mul);
+  stats.b2a = gates(ref.b2a, ref2.b2a);
+  stats.a2y = gates(ref.a2y, ref2.a2y);
+  stats.b2y = gates(ref.b2y, ref2.b2y);
+
+  const long level_depth = static_cast<long>(ref2.depth) - ref.depth;
+  const long levels = ceil_log2(size) - ceil_log2(ref_size);
+  stats.depth = static_cast<uint32_t>(max(1l, ref.depth + levels * level_depth));
+  return stats;
+}
+
+double estimate_communication(const CircuitStats& stats, size_t bitlen) {
+  const double value_bytes = bitlen / 8.;
+  // Yao: two ciphertexts per AND gate (half-gates)
+  const double yao_and = 2 * KAPPA_BYTES;
+  // GMW: two random OTs per multiplication triple, plus opening two bits in
+  // the online phase
+  const double gmw_and = 2 * KAPPA_BYTES + 0.5;
+  // Arithmetic: two times bitlen correlated OTs of values per multiplication
+  // triple, plus opening two values in the online phase
+  const double arith_mul = 2 * bitlen * (KAPPA_BYTES + value_bytes) + 4 * value_bytes;
+  // B2A: one correlated OT of a value per bit
+  const double b2a = KAPPA_BYTES + value_bytes;
+  // A2Y, B2Y: one OT of the two wire labels per bit
+  const double to_yao = 3 * KAPPA_BYTES;
+
+  return stats.yao_and * yao_and + stats.gmw_and * gmw_and
+    + stats.arith_mul * arith_mul + stats.b2a * b2a
+    + (stats.a2y + stats.b2y) * to_yao;
+}
+
+double predict_runtime(const CircuitStats& stats, const NetworkProfile& network,
+    size_t bitlen) {
+  return stats.depth * network.rtt
+    + estimate_communication(stats, bitlen) / network.bandwidth;
+}
+
+} // namespace sel::aby
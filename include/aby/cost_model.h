@@ -0,0 +1,89 @@
+/**
+ \file    sel/aby/cost_model.h
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Runtime prediction of ABY circuits from gate statistics
+*/
+
+#ifndef SEL_ABY_COST_MODEL_H
+#define SEL_ABY_COST_MODEL_H
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// forward declarations
+class ABYParty;
+
+namespace sel::aby {
+
+/**
+ * Network connection between the two parties
+ */
+struct NetworkProfile {
+  double rtt; // round-trip time in seconds
+  double bandwidth; // in bytes per second
+};
+
+/**
+ * Gate statistics of a built ABY circuit. As explained in StatsPrinter, AND,
+ * MUL and conversion gates are counted per bit or value, the depth is the
+ * number of interactive communication rounds.
+ */
+struct CircuitStats {
+  uint64_t gmw_and{0}, yao_and{0}, arith_mul{0};
+  uint64_t b2a{0}, a2y{0}, b2y{0};
+  uint32_t depth{0};
+};
+
+/**
+ * Reads the statistics of the circuit currently built in party.
+ */
+CircuitStats read_circuit_stats(ABYParty& party);
+
+/**
+ * Extrapolates the statistics of a circuit over num_records records and a
+ * database of size entries from two reference circuits of a single record and
+ * ref_size and 2*ref_size database entries, ref_size being a power of two.
+ * Gate counts are linear in the number of compared pairs, so they are
+ * interpolated affinely in the database size and scaled by the number of
+ * records. The depth grows by a constant number of rounds with each level of
+ * the fold over the database, so it is extrapolated in ceil(log2(size)) and
+ * doesn't depend on the number of records, which are evaluated in parallel.
+ *
+ * The error of this model is small compared to the differences between the
+ * sharings: gate counts are exact up to the constant per-circuit overhead,
+ * which is scaled by num_records, and the depth may be off by the rounds of a
+ * single fold level if a fold needs an extra level for a remainder.
+ */
+CircuitStats extrapolate_circuit_stats(const CircuitStats& ref,
+    const CircuitStats& ref2, size_t ref_size, size_t num_records, size_t size);
+
+/**
+ * Rough estimate of the bytes sent by both parties in the setup and online
+ * phase to evaluate a circuit with given statistics and arithmetic bitlen.
+ */
+double estimate_communication(const CircuitStats& stats, size_t bitlen);
+
+/**
+ * Predicted runtime in seconds of a circuit with given statistics over given
+ * network: every round costs a round-trip and all data has to be sent through
+ * the bandwidth. Local computation is neglected.
+ */
+double predict_runtime(const CircuitStats& stats, const NetworkProfile& network,
+    size_t bitlen);
+
+} // namespace sel::aby
+
+#endif /* end of include guard: SEL_ABY_COST_MODEL_H */
@@ -20,6 +20,7 @@
 #include <type_traits>
 #include "gadgets.h"
 #include "../util.h"
+#include "../math.h"
 
 #ifdef DEBUG_SEL_GADGETS
 #include <fmt/format.h>
@@ -98,6 +99,59 @@ BoolShare max(const vector<BoolShare>& shares) {
   return BoolShare(circ, circ->PutMaxGate(shs));
 }
 
+BoolShare low_depth_hammingweight(const BoolShare& s) {
+  BooleanCircuit* bc = s.get_circuit();
+  const uint32_t bitlen = s.get_bitlen();
+  const size_t out_bits = ceil_log2_min1(bitlen + 1);
+
+  // Wires of bits of weight 2^k by column k. Bits in columns >= out_bits
+  // would exceed the maximum hammingweight bitlen, so they are always zero and
+  // can be dropped.
+  vector<vector<uint32_t>> columns(out_bits);
+  columns[0] = s.get()->get_wires();
+  const auto max_height = [&columns]() {
+    size_t h = 0;
+    for (const auto& col : columns) h = std::max(h, col.size());
+    return h;
+  };
+
+  // Carry-save compression, each layer of full adders costs one AND in depth
+  while (max_height() > 2) {
+    vector<vector<uint32_t>> next(out_bits);
+    for (size_t k = 0; k != out_bits; ++k) {
+      const auto& col = columns[k];
+      size_t i = 0;
+      for (; i + 3 <= col.size(); i += 3) {
+        const uint32_t a = col[i], b = col[i+1], c = col[i+2];
+        const uint32_t ac = bc->PutXORGate(a, c);
+        next[k].push_back(bc->PutXORGate(ac, b));
+        if (k + 1 != out_bits) {
+          // majority(a, b, c) = ((a^c) & (b^c)) ^ c
+          const uint32_t carry = bc->PutXORGate(
+              bc->PutANDGate(ac, bc->PutXORGate(b, c)), c);
+          next[k+1].push_back(carry);
+        }
+      }
+      next[k].insert(next[k].end(), col.begin() + i, col.end());
+    }
+    columns = move(next);
+  }
+
+  // Final addition of the two remaining rows
+  const uint32_t zero = bc->PutConstantGate(0, s.get_nvals());
+  vector<uint32_t> row_a(out_bits, zero), row_b(out_bits, zero);
+  bool two_rows = false;
+  for (size_t k = 0; k != out_bits; ++k) {
+    if (columns[k].size() > 0) row_a[k] = columns[k][0];
+    if (columns[k].size() > 1) {
+      row_b[k] = columns[k][1];
+      two_rows = true;
+    }
+  }
+  if (!two_rows) return BoolShare{bc, row_a};
+  return BoolShare{bc, bc->PutDepthOptimizedAddGate(row_a, row_b)};
+}
+
 template <class ShareT>
 ShareT sum(const vector<ShareT>& shares) {
   BinaryOp<ShareT> op = [](auto a, auto b) {return a + b;};
@@ -112,7 +166,11 @@ template ArithShare sum(const vector<ArithShare>&);
  * log(nvals) simd operations as if simd_share was completely split into nval
  * shares and then binary_accumulate()'d.
  */
-BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op) {
+BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op,
+    size_t nsegments) {
+  assert (simd_share.get_nvals() % nsegments == 0);
+  // All counts are in blocks of nsegments values, one of each segment
+  const size_t nblocks = simd_share.get_nvals() / nsegments;
 #ifdef DEBUG_SEL_GADGETS
   cout << "==== split-accumulating share of nvals: " << simd_share.get_nvals() << " ====\n";
 #endif
@@ -123,8 +181,8 @@ BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op)
   // stack
   BoolShare stack_share;
   assert (!(bool)stack_share);
-  for(size_t cnvals{simd_share.get_nvals()/2}, rem{simd_share.get_nvals()%2};
-      simd_share.get_nvals() > 1; rem = cnvals%2, cnvals /=2) {
+  for(size_t cnvals{nblocks/2}, rem{nblocks%2};
+      simd_share.get_nvals() > nsegments; rem = cnvals%2, cnvals /=2) {
 #ifdef DEBUG_SEL_GADGETS
     cout << "cnvals: " << cnvals << " rem: " << rem << "\n";
 #endif
@@ -146,7 +204,7 @@ BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op)
       rem = 0;
     }
 
-    vector<BoolShare> splits = simd_share.split(cnvals);
+    vector<BoolShare> splits = simd_share.split(cnvals * nsegments);
 
     // push to stack if remainder
     if (splits.size() > 2) {
@@ -156,10 +214,10 @@ BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op)
       assert (splits.size() == 3);
       assert (rem == 1);
       stack_share = move(splits.back());
-      assert (stack_share.get_nvals() == 1);
+      assert (stack_share.get_nvals() == nsegments);
     }
-    assert (splits[0].get_nvals() == cnvals);
-    assert (splits[1].get_nvals() == cnvals);
+    assert (splits[0].get_nvals() == cnvals * nsegments);
+    assert (splits[1].get_nvals() == cnvals * nsegments);
     simd_share = op(splits[0], splits[1]);
   }
   // finally accumulate with stack
@@ -172,6 +230,33 @@ BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op)
   return simd_share;
 }
 
+BoolShare contiguous_accumulate(const BoolShare& simd_share,
+    const BinaryOp<BoolShare>& op, size_t nsegments) {
+  if (nsegments == 1) return split_accumulate(simd_share, op);
+  assert (simd_share.get_nvals() % nsegments == 0);
+  size_t segsize = simd_share.get_nvals() / nsegments;
+  vector<BoolShare> segments = simd_share.split(segsize);
+  while (segsize > 1) {
+    const size_t half = segsize / 2;
+    vector<BoolShare> lows, highs, rests;
+    for (const auto& segment : segments) {
+      auto parts = segment.split(half);
+      lows.push_back(parts[0]);
+      highs.push_back(parts[1]);
+      if (parts.size() > 2) rests.push_back(parts[2]);
+    }
+    segments = op(vcombine(lows), vcombine(highs)).split(half);
+    // Odd segments keep their last value for the next level
+    if (!rests.empty()) {
+      for (size_t i = 0; i != nsegments; ++i) {
+        segments[i] = vcombine<BoolShare>({segments[i], rests[i]});
+      }
+    }
+    segsize = half + !rests.empty();
+  }
+  return vcombine(segments);
+}
+
 void split_select_target(BoolShare& selector, BoolShare& target,
     const BinaryOp<BoolShare>& op_select) {
   assert (selector.get_nvals() == target.get_nvals());
@@ -229,75 +314,128 @@ void split_select_target(BoolShare& selector, BoolShare& target,
   }
 }
 
+/**
+ * Compares quotients a and b by cross-multiplication and breaks ties of equal
+ * quotients by op_select on the tie keys a_key and b_key, or on the
+ * denominators if the keys are null.
+ */
 template <class ShareT>
-QuotientSelector<ShareT> make_tie_selector(const T2BConverter<ShareT>& to_bool,
-    const BinaryOp<BoolShare>& op_select, const size_t den_bits = 0) {
-  return [&to_bool, op_select, den_bits] (auto a, auto b) {
-      BoolShare ax, bx, a_den, b_den;
-      if constexpr(is_same_v<ShareT, ArithShare>) {
-        ax = to_bool(a.num * b.den);
-        bx = to_bool(b.num * a.den);
-        a_den = to_bool(a.den);
-        b_den = to_bool(b.den);
-      } else {
-        ax = a.num * b.den;
-        bx = b.num * a.den;
-        a_den = a.den;
-        b_den = b.den;
-      }
+BoolShare tie_select(const T2BConverter<ShareT>& to_bool,
+    const BinaryOp<BoolShare>& op_select,
+    const Quotient<ShareT>& a, const Quotient<ShareT>& b,
+    const BoolShare& a_key, const BoolShare& b_key,
+    const size_t den_bits, const size_t num_bits) {
+  // Cross products fit into prod_bits if bounds are known
+  const size_t prod_bits = (num_bits && den_bits) ? num_bits + den_bits : 0;
+  const auto narrow = [](const BoolShare& x, size_t bits) {
+    return (bits && bits < x.get_bitlen()) ? x.with_bitlength(bits) : x;
+  };
+  const bool keyed = !a_key.is_null();
+
+  BoolShare ax, bx, a_tie, b_tie;
+  if constexpr(is_same_v<ShareT, ArithShare>) {
+    ax = narrow(to_bool(a.num * b.den), prod_bits);
+    bx = narrow(to_bool(b.num * a.den), prod_bits);
+    if (!keyed) {
+      a_tie = to_bool(a.den);
+      b_tie = to_bool(b.den);
+    }
+  } else if (prod_bits) {
+    // Pad or truncate the factors to the product width first, so that the
+    // boolean multiplications neither overflow nor run on excess bits.
+    ax = BoolShare{a.num.with_bitlength(prod_bits) * b.den.with_bitlength(prod_bits)}
+      .with_bitlength(prod_bits);
+    bx = BoolShare{b.num.with_bitlength(prod_bits) * a.den.with_bitlength(prod_bits)}
+      .with_bitlength(prod_bits);
+    a_tie = a.den;
+    b_tie = b.den;
+  } else {
+    ax = a.num * b.den;
+    bx = b.num * a.den;
+    a_tie = a.den;
+    b_tie = b.den;
+  }
 
-      auto quotients_equal = ax == bx;
-      auto quotient_select = op_select(ax, bx);
+  if (keyed) {
+    a_tie = a_key;
+    b_tie = b_key;
+  } else {
+    a_tie = narrow(a_tie, den_bits);
+    b_tie = narrow(b_tie, den_bits);
+  }
 
-      if (den_bits) {
-        a_den.set_bitlength(den_bits);
-        b_den.set_bitlength(den_bits);
-      }
-      auto scale_select = op_select(a_den, b_den);
+  auto quotients_equal = ax == bx;
+  auto quotient_select = op_select(ax, bx);
+  auto tie_break = op_select(a_tie, b_tie);
 
-      // If quotients are equal, select by scale.
-      auto selection = quotient_select | (quotients_equal & scale_select);
+  // If quotients are equal, select by scale or tie key.
+  auto selection = quotient_select | (quotients_equal & tie_break);
 
 #ifdef DEBUG_SEL_GADGETS
-      static unsigned i = 0;
-      const string i_str = '[' + to_string(i++) + "] ";
-      print_share(a, i_str+"selector a");
-      print_share(b, i_str+"selector b");
-      print_share(a_den, i_str+"a_den");
-      print_share(b_den, i_str+"b_den");
-      print_share(quotients_equal, i_str+"quotients_equal");
-      print_share(quotient_select, i_str+"quotient_select");
-      print_share(scale_select, i_str+"scale_select");
-      print_share(selection, i_str+"selection");
+  static unsigned i = 0;
+  const string i_str = '[' + to_string(i++) + "] ";
+  print_share(a, i_str+"selector a");
+  print_share(b, i_str+"selector b");
+  print_share(a_tie, i_str+"a_tie");
+  print_share(b_tie, i_str+"b_tie");
+  print_share(quotients_equal, i_str+"quotients_equal");
+  print_share(quotient_select, i_str+"quotient_select");
+  print_share(tie_break, i_str+"tie_break");
+  print_share(selection, i_str+"selection");
 #endif
 
-      return selection;
+  return selection;
+}
+
+template <class ShareT>
+QuotientSelector<ShareT> make_tie_selector(const T2BConverter<ShareT>& to_bool,
+    const BinaryOp<BoolShare>& op_select, const size_t den_bits = 0,
+    const size_t num_bits = 0) {
+  return [&to_bool, op_select, den_bits, num_bits] (auto a, auto b) {
+    return tie_select(to_bool, op_select, a, b, BoolShare{}, BoolShare{},
+        den_bits, num_bits);
   };
 }
 
 template <class ShareT>
 QuotientSelector<ShareT> make_max_tie_selector(const T2BConverter<ShareT>& to_bool,
-    const size_t den_bits) {
+    const size_t den_bits, const size_t num_bits) {
   BinaryOp<BoolShare> op_select = [](auto a, auto b) { return a > b; };
-  return make_tie_selector(to_bool, op_select, den_bits);
+  return make_tie_selector(to_bool, op_select, den_bits, num_bits);
 }
 
 template
-QuotientSelector<BoolShare> make_max_tie_selector(const T2BConverter<BoolShare>&, const size_t);
+QuotientSelector<BoolShare> make_max_tie_selector(const T2BConverter<BoolShare>&, const size_t, const size_t);
 template
-QuotientSelector<ArithShare> make_max_tie_selector(const T2BConverter<ArithShare>&, const size_t);
+QuotientSelector<ArithShare> make_max_tie_selector(const T2BConverter<ArithShare>&, const size_t, const size_t);
 
 template <class ShareT>
 QuotientSelector<ShareT> make_min_tie_selector(const T2BConverter<ShareT>& to_bool,
-    const size_t den_bits) {
+    const size_t den_bits, const size_t num_bits) {
   BinaryOp<BoolShare> op_select = [](auto a, auto b) { return a < b; };
-  return make_tie_selector(to_bool, op_select, den_bits);
+  return make_tie_selector(to_bool, op_select, den_bits, num_bits);
+}
+
+template
+QuotientSelector<BoolShare> make_min_tie_selector(const T2BConverter<BoolShare>&, const size_t, const size_t);
+template
+QuotientSelector<ArithShare> make_min_tie_selector(const T2BConverter<ArithShare>&, const size_t, const size_t);
+
+template <class ShareT>
+KeyedQuotientSelector<ShareT> make_max_keyed_tie_selector(
+    const T2BConverter<ShareT>& to_bool,
+    const size_t den_bits, const size_t num_bits) {
+  BinaryOp<BoolShare> op_select = [](auto a, auto b) { return a > b; };
+  return [&to_bool, op_select, den_bits, num_bits] (auto a, auto b,
+      const BoolShare& a_key, const BoolShare& b_key) {
+    return tie_select(to_bool, op_select, a, b, a_key, b_key, den_bits, num_bits);
+  };
 }
 
 template
-QuotientSelector<BoolShare> make_min_tie_selector(const T2BConverter<BoolShare>&, const size_t);
+KeyedQuotientSelector<BoolShare> make_max_keyed_tie_selector(const T2BConverter<BoolShare>&, const size_t, const size_t);
 template
-QuotientSelector<ArithShare> make_min_tie_selector(const T2BConverter<ArithShare>&, const size_t);
+KeyedQuotientSelector<ArithShare> make_max_keyed_tie_selector(const T2BConverter<ArithShare>&, const size_t, const size_t);
 
 template <class ShareT>
 QuotientSelector<ShareT> make_max_selector(const T2BConverter<ShareT>& to_bool) {
@@ -409,14 +547,17 @@ BoolQuotient max(const ArithQuotient& a, const ArithQuotient& b,
 }
 
 BoolShare ascending_numbers_constant(BooleanCircuit* bcirc,
-    size_t nvals, size_t start) {
+    size_t nvals, size_t start, size_t repeat, size_t bitlen) {
   // TODO Make true SIMD constants available in ABY and implement offline
   // AND with constant
   vector<BoolShare> numbers;
   numbers.reserve(nvals);
   size_t end = nvals + start;
+  if (!bitlen) bitlen = ceil_log2_min1(end);
   for (size_t i = start; i != end; ++i) {
-    numbers.emplace_back(constant(bcirc, i, ceil_log2_min1(end)));
+    numbers.emplace_back((repeat == 1) ?
+        constant(bcirc, i, bitlen) :
+        constant_simd(bcirc, i, bitlen, repeat));
   }
   return vcombine<BoolShare>(numbers);
 }
@@ -36,6 +36,9 @@ template <class ShareT>
   using BinaryOp = std::function<ShareT (const ShareT&, const ShareT&)>;
 template <class ShareT>
   using QuotientSelector = std::function<BoolShare (const Quotient<ShareT>&, const Quotient<ShareT>&)>;
+template <class ShareT>
+  using KeyedQuotientSelector = std::function<BoolShare (const Quotient<ShareT>&,
+      const Quotient<ShareT>&, const BoolShare&, const BoolShare&)>;
 
 template <class ShareT>
   using T2BConverter = std::function<BoolShare (const ShareT&)>;
@@ -55,8 +58,22 @@ void print_share(const Quotient<ShareT>& q, const std::string& msg);
  * then op applied to only two values, effectively dividing nvals by 2 in each
  * iteration. If nvals is odd, remainder share is saved and later appended if
  * there is another odd split.
+ *
+ * If nsegments > 1, nsegments interleaved segments are accumulated
+ * independently, i.e., the k-th value belongs to segment k % nsegments, and a
+ * share of nsegments values is returned.
+ */
+BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op,
+    size_t nsegments = 1);
+
+/**
+ * Like split_accumulate with nsegments, but for contiguous segments, i.e., the
+ * k-th value belongs to segment k / segsize, segsize being nvals / nsegments.
+ * Each level halves all segments at once and applies op to the combined
+ * halves, so it also runs in log2(segsize) levels of a single SIMD op.
  */
-BoolShare split_accumulate(BoolShare simd_share, const BinaryOp<BoolShare>& op);
+BoolShare contiguous_accumulate(const BoolShare& simd_share,
+    const BinaryOp<BoolShare>& op, size_t nsegments = 1);
 
 /**
  * Like split_accumulate but more specific to running a selector op_select which
@@ -73,12 +90,28 @@ QuotientSelector<ShareT> make_max_selector(const T2BConverter<ShareT>& to_bool);
 template <class ShareT>
 QuotientSelector<ShareT> make_min_selector(const T2BConverter<ShareT>& to_bool);
 
+/**
+ * Tie selectors compare quotients by cross-multiplication and break ties by
+ * the denominators. If known, den_bits and num_bits bound the bitlengths of
+ * denominators and numerators, so that comparisons of converted arithmetic
+ * shares can be truncated and boolean cross-multiplications run on only
+ * num_bits + den_bits instead of the full bitlength.
+ */
 template <class ShareT>
 QuotientSelector<ShareT> make_max_tie_selector(const T2BConverter<ShareT>& to_bool,
-    const size_t den_bits = 0);
+    const size_t den_bits = 0, const size_t num_bits = 0);
 template <class ShareT>
 QuotientSelector<ShareT> make_min_tie_selector(const T2BConverter<ShareT>& to_bool,
-    const size_t den_bits = 0);
+    const size_t den_bits = 0, const size_t num_bits = 0);
+
+/**
+ * Like the max tie selector, but ties of equal quotients are broken by the
+ * larger of the given tie keys instead of the larger denominator.
+ */
+template <class ShareT>
+KeyedQuotientSelector<ShareT> make_max_keyed_tie_selector(
+    const T2BConverter<ShareT>& to_bool,
+    const size_t den_bits = 0, const size_t num_bits = 0);
 
 template <class ShareT>
 ShareT sum(const std::vector<ShareT>&);
@@ -91,6 +124,18 @@ ArithQuotient max_tie(const std::vector<ArithQuotient>& qs,
 
 BoolShare max(const std::vector<BoolShare>&);
 
+/**
+ * Hammingweight of given share with a depth-minimized adder tree: The bits are
+ * compressed column-wise with full adders (carry-save), each layer of which
+ * costs a single AND in depth, until at most two bits per column are left,
+ * which are then added by a single depth-optimized adder. ABY's
+ * PutHammingWeightGate uses a tree of ripple-carry adders instead, whose depth
+ * grows with the square of the log of the input bitlen. So this gadget needs
+ * fewer communication rounds in GMW, at about the same number of AND gates.
+ * Output has bitlen hw_size(bitlen), like hammingweight().
+ */
+BoolShare low_depth_hammingweight(const BoolShare&);
+
 BoolQuotient max(const ArithQuotient& a, const ArithQuotient& b,
     const A2BConverter& to_bool);
 ArithQuotient max(const ArithQuotient& a, const ArithQuotient& b,
@@ -98,8 +143,15 @@ ArithQuotient max(const ArithQuotient& a, const ArithQuotient& b,
 ArithQuotient max(const std::vector<ArithQuotient>& qs,
     const A2BConverter& to_bool, const B2AConverter& to_arith);
 
+/**
+ * Returns a constant SIMD share holding the numbers start, ..., start+nvals-1.
+ * If repeat > 1, each number is repeated that many times, resulting in
+ * nvals*repeat values {start, start, ..., start+1, start+1, ...}
+ * The numbers have given bitlen, or the minimal bitlen of the largest number if
+ * 0.
+ */
 BoolShare ascending_numbers_constant(BooleanCircuit* bcirc,
-    size_t nvals, size_t start = 0);
+    size_t nvals, size_t start = 0, size_t repeat = 1, size_t bitlen = 0);
 
 } // namespace sel
 #endif /* end of include guard: SEL_ABY_GADGETS_H */
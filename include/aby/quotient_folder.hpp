@@ -22,6 +22,7 @@
 #define SEL_ABY_QUOTIENT_FOLDER_H
 #pragma once
 
+#include <optional>
 #include "gadgets.h"
 
 namespace sel {
@@ -63,6 +64,54 @@ public:
       den_bits = _den_bits;
   }
 
+  /**
+   * Set upper bounds of the bitlengths of numerators and denominators.
+   * Cross-multiplications and comparisons of the tie selectors then only run on
+   * the required bits. In boolean space, the selector is also truncated to these
+   * bitlengths while folding, so that all muxes shrink accordingly. The folded
+   * selector is zeropadded back to its original bitlengths, so callers can
+   * keep computing on it without overflows.
+   */
+  void set_bitlengths(const size_t _num_bits, const size_t _den_bits) {
+    num_bits = _num_bits;
+    den_bits = _den_bits;
+  }
+
+  /**
+   * Break ties of equal quotients by the larger value of the given target
+   * instead of the larger denominator. Only supported with FoldOp::MAX_TIE.
+   * If the values of the tie target are unique, the result of the fold doesn't
+   * depend on the order of folding.
+   */
+  void set_tie_target(const size_t target_index) {
+    assert (fold_op == FoldOp::MAX_TIE && target_index < base.targets.size());
+    tie_target = target_index;
+  }
+
+  /**
+   * Layout of the segments in the selector and targets, see set_segments().
+   */
+  enum class SegmentLayout { INTERLEAVED, CONTIGUOUS };
+
+  /**
+   * Fold nsegments segments independently. The number of values must be a
+   * multiple of nsegments. fold() then returns nsegments values, the i-th
+   * being the result of segment i.
+   * With the interleaved layout, the k-th value of the selector and targets
+   * belongs to segment k % nsegments. With the contiguous layout, the segments
+   * are concatenated, i.e., the k-th value belongs to segment k / segsize,
+   * segsize being the number of values per segment. The latter allows to fold
+   * independently built shares, e.g., of several records, in the same rounds
+   * after vertically combining them. Each fold level then splits and combines
+   * the segments, which costs no interaction.
+   */
+  void set_segments(size_t _nsegments,
+      SegmentLayout _layout = SegmentLayout::INTERLEAVED) {
+    assert (_nsegments > 0 && base.size() % _nsegments == 0);
+    nsegments = _nsegments;
+    layout = _layout;
+  }
+
   class Leaf {
   public:
     Leaf() = default;
@@ -101,18 +150,6 @@ public:
     Quotient<ShareT> selector;
     std::vector<BoolShare> targets;
 
-    bool odd_size() const { return size() % 2; }
-
-    Leaf& append(const Leaf& other) {
-      selector.num = vcombine<ShareT>({selector.num, other.selector.num});
-      selector.den = vcombine<ShareT>({selector.den, other.selector.den});
-      assert (targets.size() == other.targets.size());
-      for(size_t i=0; i!=targets.size(); ++i) {
-        targets[i] = vcombine<BoolShare>({targets[i], other.targets[i]});
-      }
-      return *this;
-    }
-
     /**
      * Takes the i'th slice in all split result vectors
      */
@@ -126,13 +163,24 @@ public:
 
   Leaf fold() {
     auto op_select = make_selector();
+    [[maybe_unused]] const uint32_t num_bitlen = base.selector.num.get_bitlen();
+    [[maybe_unused]] const uint32_t den_bitlen = base.selector.den.get_bitlen();
+    if constexpr (!do_conversion) {
+      base.selector.num = narrow(base.selector.num, num_bits);
+      base.selector.den = narrow(base.selector.den, den_bits);
+    }
 
-    while (base.size() > 1) {
+    while (nblocks(base) > 1) {
       split_half();
       fold_once(other, op_select);
-      if (base.odd_size() && have_remainder()) append_remainder();
+      if (nblocks(base) % 2 && have_remainder()) append_remainder();
     }
     if (have_remainder()) fold_once(remainder, op_select);
+
+    if constexpr (!do_conversion) {
+      base.selector.num = base.selector.num.with_bitlength(num_bitlen);
+      base.selector.den = base.selector.den.with_bitlength(den_bitlen);
+    }
     return base;
   }
 
@@ -142,18 +190,43 @@ private:
   T2BConverter<ShareT> const* to_bool = nullptr;
   B2AConverter const* to_arith = nullptr;
   size_t den_bits = 0;
+  size_t num_bits = 0;
+  size_t nsegments = 1;
+  SegmentLayout layout = SegmentLayout::INTERLEAVED;
+  std::optional<size_t> tie_target;
+
+  using LeafSelector = std::function<BoolShare (const Leaf&, const Leaf&)>;
+
+  /**
+   * Number of values per segment of given leaf
+   */
+  size_t nblocks(const Leaf& leaf) const { return leaf.size() / nsegments; }
 
-  QuotientSelector<ShareT> make_selector() {
+  LeafSelector make_selector() const {
+    if (tie_target) {
+      auto keyed_select = make_max_keyed_tie_selector(*to_bool, den_bits, num_bits);
+      return [keyed_select, t = *tie_target] (const Leaf& a, const Leaf& b) {
+        return keyed_select(a.selector, b.selector, a.targets[t], b.targets[t]);
+      };
+    }
+    QuotientSelector<ShareT> select;
     switch (fold_op) {
       case FoldOp::MIN:
-        return make_min_selector(*to_bool);
+        select = make_min_selector(*to_bool); break;
       case FoldOp::MAX:
-        return make_max_selector(*to_bool);
+        select = make_max_selector(*to_bool); break;
       case FoldOp::MIN_TIE:
-        return make_min_tie_selector(*to_bool, den_bits);
+        select = make_min_tie_selector(*to_bool, den_bits, num_bits); break;
       default: // MAX_TIE is default
-        return make_max_tie_selector(*to_bool, den_bits);
+        select = make_max_tie_selector(*to_bool, den_bits, num_bits);
     }
+    return [select] (const Leaf& a, const Leaf& b) {
+      return select(a.selector, b.selector);
+    };
+  }
+
+  static BoolShare narrow(const BoolShare& share, size_t bits) {
+    return (bits && bits < share.get_bitlen()) ? share.with_bitlength(bits) : share;
   }
 
   bool have_remainder() const { return remainder.size() > 0; }
@@ -161,20 +234,28 @@ private:
 #ifdef DEBUG_SEL_GADGETS
     std::cout << ">> appending remainder\n";
 #endif
-    base.append(remainder);
+    base.selector.num = append_blocks(base.selector.num, remainder.selector.num);
+    base.selector.den = append_blocks(base.selector.den, remainder.selector.den);
+    assert (base.targets.size() == remainder.targets.size());
+    for(size_t i=0; i!=base.targets.size(); ++i) {
+      base.targets[i] = append_blocks(base.targets[i], remainder.targets[i]);
+    }
     remainder.reset();
   }
 
   void split_half() {
-    size_t half_size = base.size()/2;
+    const size_t half_blocks = nblocks(base)/2;
+    const size_t half_size = half_blocks * nsegments;
 #ifdef DEBUG_SEL_GADGETS
     std::cout << "> Splitting " << base.size() << " to " << half_size
       << " % " << base.size()%2 << '\n';
 #endif
-    auto splits_num = base.selector.num.split(half_size);
-    auto splits_den = base.selector.den.split(half_size);
+    auto splits_num = split_blocks(base.selector.num, half_blocks);
+    auto splits_den = split_blocks(base.selector.den, half_blocks);
     auto split_targets = transform_vec(base.targets,
-        [&half_size](const BoolShare& target) { return target.split(half_size); });
+        [this, &half_blocks](const BoolShare& target) {
+          return split_blocks(target, half_blocks);
+        });
 
     base = Leaf::slice_vec(splits_num, splits_den, split_targets, 0);
     other = Leaf::slice_vec(splits_num, splits_den, split_targets, 1);
@@ -188,13 +269,55 @@ private:
       assert (splits_num.size() == 3);
       assert (splits_den.size() == 3);
       remainder = Leaf::slice_vec(splits_num, splits_den, split_targets, 2);
-      assert (remainder.size() == 1);
+      assert (remainder.size() == nsegments);
+    }
+  }
+
+  /**
+   * Splits given share into its first h blocks, the next h blocks and the
+   * remaining block, if any, respecting the segment layout. A block consists
+   * of one value of each segment.
+   */
+  template <class S>
+  std::vector<S> split_blocks(const S& share, size_t h) const {
+    if (layout == SegmentLayout::INTERLEAVED || nsegments == 1) {
+      return share.split(h * nsegments);
+    }
+    const size_t segsize = share.get_nvals() / nsegments;
+    std::vector<std::vector<S>> parts(segsize > 2*h ? 3 : 2);
+    for (const auto& segment : share.split(segsize)) {
+      auto segment_parts = segment.split(h);
+      assert (segment_parts.size() == parts.size());
+      for (size_t i = 0; i != parts.size(); ++i) {
+        parts[i].emplace_back(std::move(segment_parts[i]));
+      }
+    }
+    return transform_vec(parts, [](const std::vector<S>& p) { return vcombine<S>(p); });
+  }
+
+  /**
+   * Appends the single block of rest to the blocks of given share, respecting
+   * the segment layout.
+   */
+  template <class S>
+  S append_blocks(const S& share, const S& rest) const {
+    if (layout == SegmentLayout::INTERLEAVED || nsegments == 1) {
+      return vcombine<S>({share, rest});
+    }
+    const auto segments = share.split(share.get_nvals() / nsegments);
+    const auto rests = rest.split(1);
+    std::vector<S> parts;
+    parts.reserve(2*nsegments);
+    for (size_t i = 0; i != nsegments; ++i) {
+      parts.push_back(segments[i]);
+      parts.push_back(rests[i]);
     }
+    return vcombine<S>(parts);
   }
 
-  void fold_once(const Leaf& with, const QuotientSelector<ShareT>& op_select) {
+  void fold_once(const Leaf& with, const LeafSelector& op_select) {
     assert(base.size() == with.size());
-    auto selection = op_select(base.selector, with.selector);
+    auto selection = op_select(base, with);
     if constexpr (do_conversion) {
       ArithShare arith_sel = (*to_arith)(selection);
       ArithmeticCircuit* ac = base.selector.num.get_circuit();
@@ -25,6 +25,7 @@ using fmt::format;
 #include "logger.h"
 #include "aby/Share.h"
 #include "aby/quotient_folder.hpp"
+#include "aby/circuit_file.h"
 
 using namespace std;
 
@@ -34,9 +35,11 @@ namespace sel {
   * Return type of weight_compare_*()
   * fw - field weight = weight * comparison * empty-deltas
   * w - weight for weight sum = weight * empyt-deltas
+  * scale - only in division-free dice mode: common denominator by which fw and
+  *   w are scaled, i.e., the actual field weight is fw/scale. Null if 1.
   */
 template <class MultShare>
-struct FieldWeight { MultShare fw, w; };
+struct FieldWeight { MultShare fw, w, scale; };
 
 template <class MultShare>
 struct LinkageShares {
@@ -55,19 +58,39 @@ void print_share(const FieldWeight<MultShare>& q, const string& msg) {
 #endif
 
 /**
- * Sums all fw's and w's in given vector and returns sums as ArithQuotient
+ * Sums all fw's and w's in given vector. Scaled field weights are added by
+ * bringing them to a common denominator, which is the scale of the sum.
  */
 template <class MultShare>
-Quotient<MultShare> sum(const vector<FieldWeight<MultShare>>& fweights) {
+FieldWeight<MultShare> sum(const vector<FieldWeight<MultShare>>& fweights) {
   size_t size = fweights.size();
   vector<MultShare> fws, ws;
+  vector<const FieldWeight<MultShare>*> scaled;
   fws.reserve(size);
   ws.reserve(size);
   for (const auto& fweight : fweights) {
-    fws.emplace_back(fweight.fw);
-    ws.emplace_back(fweight.w);
+    if (fweight.scale) {
+      scaled.push_back(&fweight);
+    } else {
+      fws.emplace_back(fweight.fw);
+      ws.emplace_back(fweight.w);
+    }
   }
-  return {sum(fws), sum(ws)};
+
+  FieldWeight<MultShare> res;
+  if (!fws.empty()) res = {sum(fws), sum(ws), {}};
+  // fw/s + fw'/s' = (fw*s' + fw'*s)/(s*s')
+  for (const auto s : scaled) {
+    if (!res.fw) {
+      res = *s;
+    } else if (!res.scale) {
+      res = {res.fw * s->scale + s->fw, res.w * s->scale + s->w, s->scale};
+    } else {
+      res = {res.fw * s->scale + s->fw * res.scale,
+        res.w * s->scale + s->w * res.scale, res.scale * s->scale};
+    }
+  }
+  return res;
 }
 
 /**
@@ -84,11 +107,13 @@ class CircuitBuilder : public CircuitBuilderBase {
 public:
   CircuitBuilder(CircuitConfig cfg_,
       BooleanCircuit* bcirc, BooleanCircuit* ccirc, ArithmeticCircuit* acirc) :
-    cfg{cfg_}, bcirc{bcirc}, ccirc{ccirc}, acirc{acirc},
+    cfg{cfg_}, plan{make_comparison_plan(cfg)},
+    bcirc{bcirc}, ccirc{ccirc}, acirc{acirc},
     ins{cfg, bcirc, acirc}, // CircuitInput
     to_bool_closure{[this](auto x){return to_bool(x);}},
     to_arith_closure{[this](auto x){return to_arith(x);}}
   {
+    preload_int_div_circuits();
     get_logger()->trace("CircuitBuilder created.");
   }
 
@@ -112,11 +137,17 @@ public:
       throw new runtime_error("Set the input first before building the ciruit!");
     }
 
+    // Intermediate database chunks only output the running best
+    if (!ins.is_last_chunk()) {
+      build_running_best();
+      built = true;
+      return {};
+    }
+
     vector<LinkageOutputShares> output_shares;
     output_shares.reserve(ins.nrecords());
-    for (size_t index = 0; index != ins.nrecords(); ++index) {
-      output_shares.emplace_back(
-            to_linkage_output(build_single_linkage_circuit(index)));
+    for (const auto& linkage_share : build_all_linkage_shares()) {
+      output_shares.emplace_back(to_linkage_output(linkage_share));
     }
 
     built = true;
@@ -128,19 +159,57 @@ public:
       throw new runtime_error("Set the input first before building the ciruit!");
     }
 
-    vector<LinkageShares<MultShare>> linkage_shares;
-    linkage_shares.reserve(ins.nrecords());
-    for (size_t index = 0; index != ins.nrecords(); ++index) {
-      linkage_shares.emplace_back(build_single_linkage_circuit(index));
+    const auto [match, tmatch] = any_matches();
+    built = true;
+
+    // Intermediate database chunks only output the running match bits
+    if (!ins.is_last_chunk()) {
+      running_count_out = {out_running_best(match), out_running_best(tmatch)};
+      return {};
     }
 
-    built = true;
-    return sum_linkage_shares(linkage_shares);
+    return {count_matches(match), count_matches(tmatch)};
+  }
+
+  void set_database_version(uint64_t version, bool reuse) override {
+    ins.set_database_version(version, reuse);
+  }
+
+  std::optional<uint64_t> saved_database_version() const override {
+    return ins.saved_database_version();
+  }
+
+  void save_database_shares() override {
+    ins.save_database_shares();
+  }
+
+  void set_database_chunk(size_t offset, size_t total_size) override {
+    ins.set_chunk(offset, total_size);
+    if (offset == 0) {
+      running_best.reset();
+      running_count.reset();
+    }
+  }
+
+  void save_running_best() override {
+    if (running_count_out) {
+      running_count = {running_count_out->match.get_clear_value_bytes(),
+        running_count_out->tmatch.get_clear_value_bytes()};
+      running_count_out.reset();
+    }
+    if (!running_best_out) return;
+    auto& out = *running_best_out;
+    running_best = {mult_clear_values(out.num), mult_clear_values(out.den),
+        out.index.get_clear_value_bytes(),
+        out.num_bits, out.den_bits, out.index_bits};
+    running_best_out.reset();
   }
 
   void reset() override {
     ins.clear();
     field_weight_cache.clear();
+    running_best_out.reset();
+    running_count_out.reset();
     built = false;
   }
 
@@ -150,6 +219,49 @@ private:
   using MultQuotientFolder = QuotientFolder<MultShare>;
 
   const CircuitConfig cfg;
+
+  /**
+   * Input-independent plan of the comparisons to build. It only depends on the
+   * configuration, so it is computed once and reused by every circuit build,
+   * regardless of the number of records and database size.
+   */
+  struct ExchangeGroupPlan {
+    vector<FieldId> group; // left fields
+    vector<vector<FieldId>> permutations; // right fields of all permutations
+    bool greedy; // assign greedily instead, permutations are empty then
+  };
+  struct ComparisonPlan {
+    vector<ExchangeGroupPlan> exchange_groups;
+    vector<FieldId> no_x_group; // fields not in any exchange group
+  };
+  const ComparisonPlan plan;
+
+  static ComparisonPlan make_comparison_plan(const CircuitConfig& cfg) {
+    ComparisonPlan plan;
+    // fill with field names, remove later
+    IndexSet no_x_group;
+    for (const auto& field : cfg.epi.fields) no_x_group.emplace(field.first);
+    for (const auto& group_set : cfg.epi.exchange_groups) {
+      // ids are ordered like names, so are the permutations
+      ExchangeGroupPlan xplan{transform_vec(vector<FieldName>{begin(group_set), end(group_set)},
+          [&cfg](const FieldName& i) { return cfg.field_id(i); }), {},
+          cfg.greedy_exchange_group(group_set.size())};
+      if (!xplan.greedy) {
+        // copy group to store permutations
+        auto groupPerm = xplan.group;
+        xplan.permutations.reserve(factorial<size_t>(groupPerm.size()));
+        do {
+          xplan.permutations.push_back(groupPerm);
+        } while (next_permutation(groupPerm.begin(), groupPerm.end()));
+      }
+      plan.exchange_groups.emplace_back(move(xplan));
+      // remove all indices that were covered by this index group
+      for (const auto& i : group_set) no_x_group.erase(i);
+    }
+    for (const auto& i : no_x_group) plan.no_x_group.push_back(cfg.field_id(i));
+    return plan;
+  }
+
   // Circuits
   BooleanCircuit* bcirc; // boolean circuit for boolean parts
   BooleanCircuit* ccirc; // intermediate conversion circuit
@@ -159,6 +271,35 @@ private:
   // State
   bool built{false};
 
+  /**
+   * Streaming mode: running best of all records of the previous database
+   * chunks, as output shares of the current chunk and as saved shares.
+   */
+  using MultValues = std::conditional_t<do_arith_mult, VCircUnit, Bitmask>;
+  struct RunningBestOutShares {
+    OutShare num, den, index;
+    uint32_t num_bits, den_bits, index_bits;
+  };
+  struct RunningBest {
+    MultValues num, den;
+    Bitmask index;
+    uint32_t num_bits, den_bits, index_bits;
+  };
+  optional<RunningBestOutShares> running_best_out;
+  optional<RunningBest> running_best;
+  /**
+   * Streaming mode in counting: (tentative) match bits of all records of the
+   * previous database chunks.
+   */
+  struct RunningCountOutShares {
+    OutShare match, tmatch;
+  };
+  struct RunningCount {
+    Bitmask match, tmatch;
+  };
+  optional<RunningCountOutShares> running_count_out;
+  optional<RunningCount> running_count;
+
   // Dynamic converters, dependent on main bool sharing
   BoolShare to_bool(const ArithShare& s) {
     return (bcirc->GetContext() == S_YAO) ? a2y(bcirc, s) : a2b(bcirc, ccirc, s);
@@ -186,64 +327,205 @@ private:
       return s;
   }
 
+  /**
+   * Shared output and input of the running best. Shared in- and output gates
+   * only exist for GMW and arithmetic sharing, so Yao shares are converted.
+   */
+  OutShare out_running_best(const BoolShare& s) {
+    return out_shared(to_gmw(s));
+  }
+
+  OutShare out_running_best(const ArithShare& s) {
+    return out_shared(s);
+  }
+
+  BoolShare in_running_best(Bitmask& values, uint32_t bitlen) {
+    if (bcirc->GetContext() == S_YAO) {
+      return b2y(bcirc, shared_in(ccirc, values.data(), bitlen, ins.nrecords()));
+    }
+    return shared_in(bcirc, values.data(), bitlen, ins.nrecords());
+  }
+
+  ArithShare in_running_best(VCircUnit& values, uint32_t bitlen) {
+    return shared_in(acirc, values.data(), bitlen, ins.nrecords());
+  }
+
+  static MultValues mult_clear_values(OutShare& s) {
+    if constexpr (do_arith_mult)
+      return s.get_clear_value_vec();
+    else
+      return s.get_clear_value_bytes();
+  }
+
   // closures
   const A2BConverter to_bool_closure;
   const B2AConverter to_arith_closure;
 
-  /*
-  * Builds the record linkage component of the circuit
-  */
-  LinkageShares<MultShare> build_single_linkage_circuit(size_t index) {
-    get_logger()->trace("Building linkage circuit component {}...", index);
+  /**
+   * Builds the linkage results of all records at once and splits them into the
+   * individual records' shares.
+   */
+  vector<LinkageShares<MultShare>> build_all_linkage_shares() {
+    return split_linkage_shares(build_linkage_component());
+  }
 
+  /**
+   * Builds the best matches of all records, including the previous chunks, and
+   * outputs them as the new running best.
+   */
+  void build_running_best() {
+    const auto best = best_match();
+    const auto q = best.get_selector();
+    const auto idx = best.get_targets()[0];
+    running_best_out = {out_running_best(q.num), out_running_best(q.den),
+        out_running_best(idx), q.num.get_bitlen(), q.den.get_bitlen(),
+        idx.get_bitlen()};
+    get_logger()->trace("Running best of database chunk at offset {} built.",
+        ins.chunk_offset());
+  }
+
+  /**
+   * Splits linkage shares of nrecords values into nrecords linkage
+   * shares with a single value each.
+   */
+  vector<LinkageShares<MultShare>> split_linkage_shares(
+      const LinkageShares<MultShare>& s) {
+    if (ins.nrecords() == 1) return {s};
+
+    const auto indices = s.index.split(1);
+    const auto matches = s.match.split(1);
+    const auto tmatches = s.tmatch.split(1);
+#ifdef DEBUG_SEL_RESULT
+    const auto nums = s.score_numerator.split(1);
+    const auto dens = s.score_denominator.split(1);
+#endif
+
+    vector<LinkageShares<MultShare>> linkage_shares;
+    linkage_shares.reserve(ins.nrecords());
+    for (size_t index = 0; index != ins.nrecords(); ++index) {
+#ifdef DEBUG_SEL_RESULT
+      linkage_shares.push_back({indices[index], matches[index], tmatches[index],
+          nums[index], dens[index]});
+#else
+      linkage_shares.push_back({indices[index], matches[index], tmatches[index]});
+#endif
+    }
+    return linkage_shares;
+  }
+
+  /**
+   * Builds the scores of the given client entry against the whole database
+   * chunk as field-weight-sum quotients. In batched mode, index is always 0 and
+   * the result contains the nrecords contiguous segments.
+   */
+  QuotientShare score(size_t index) {
     // Where we store all group and individual comparison weights
     vector<FieldWeight<MultShare>> field_weights;
 
     // 1. Field weights of individual fields
     // 1.1 For all exchange groups, find the permutation with the highest score
-    // Where we collect indices not already used in an exchange group
-    IndexSet no_x_group;
-    // fill with field names, remove later
-    for (const auto& field : cfg.epi.fields) no_x_group.emplace(field.first);
     // for each group, store the best permutation's weight into field_weights
-    for (const auto& group : cfg.epi.exchange_groups) {
-      // add this group's field weight to vector
-      field_weights.emplace_back(best_group_weight(index, group));
-      // remove all indices that were covered by this index group
-      for (const auto& i : group) no_x_group.erase(i);
+    for (const auto& xplan : plan.exchange_groups) {
+      field_weights.emplace_back(xplan.greedy ? greedy_group_weight(index, xplan)
+          : best_group_weight(index, xplan));
     }
-    // 1.2 Remaining indices
-    for (const auto& i : no_x_group) {
+    // 1.2 Remaining indices not already used in an exchange group
+    for (const auto& i : plan.no_x_group) {
       field_weights.emplace_back(field_weight({index, i, i}));
     }
 
-    // 2. Sum up all field weights.
-    QuotientShare sum_field_weights = sum(field_weights);
+    // 2. Sum up all field weights. In division-free dice mode, the common
+    // denominator cancels out in the score quotient.
+    const auto sum_fw = sum(field_weights);
+    QuotientShare sum_field_weights{sum_fw.fw, sum_fw.w};
 #ifdef DEBUG_SEL_CIRCUIT
     print_share(sum_field_weights, format("[{}] sum_field_weights", index));
 #endif
+    return sum_field_weights;
+  }
 
+  /**
+   * Builds the best scores of all records and their indices, that is, the
+   * maximum field-weight-sum quotients over the database, including all
+   * previous chunks in streaming mode. The result has nrecords values, the
+   * r-th being the best match of record r.
+   * The scores of all records are laid out in contiguous segments, either
+   * directly in batched mode or by vertically combining them, so that all
+   * records are folded together in log2(dbsize) rounds with a single
+   * comparison per round.
+   */
+  typename MultQuotientFolder::Leaf best_match() {
+    // 1.-2. Scores of all records
+    QuotientShare scores;
+    if (cfg.batch_records) {
+      scores = score(0);
+    } else {
+      vector<MultShare> nums, dens;
+      nums.reserve(ins.nrecords());
+      dens.reserve(ins.nrecords());
+      for (size_t index = 0; index != ins.nrecords(); ++index) {
+        auto q = score(index);
+        nums.emplace_back(move(q.num));
+        dens.emplace_back(move(q.den));
+      }
+      scores = {vcombine(nums), vcombine(dens)};
+    }
     // 3. Determine index of max score of all nvals calculations
-    const auto max_fw_and_index = max_index(move(sum_field_weights));
+    vector<BoolShare> idxs(ins.nrecords(), ins.const_idx());
+    auto best = max_targets(move(scores), {vcombine(idxs)},
+        cfg.epi.nfields, ins.nrecords(),
+        MultQuotientFolder::SegmentLayout::CONTIGUOUS);
+
+    // 3.1 In streaming mode, fold in the running best of the previous chunks
+    if (ins.chunk_offset() != 0) best = fold_running_best(best);
+    return best;
+  }
+
+  /**
+   * Folds the saved running best of all records with the best of the current
+   * chunk. The running best comes first, so that ties are resolved as if the
+   * whole database was folded at once.
+   */
+  typename MultQuotientFolder::Leaf fold_running_best(
+      const typename MultQuotientFolder::Leaf& chunk_best) {
+    assert (running_best);
+    auto& carry = *running_best;
+    const MultShare num = in_running_best(carry.num, carry.num_bits);
+    const MultShare den = in_running_best(carry.den, carry.den_bits);
+    const BoolShare idx = in_running_best(carry.index, carry.index_bits);
+    const auto q = chunk_best.get_selector();
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(QuotientShare{num, den}, "running best");
+    print_share(idx, "index of running best");
+#endif
+    return max_targets({vcombine<MultShare>({num, q.num}), vcombine<MultShare>({den, q.den})},
+        {vcombine<BoolShare>({idx, chunk_best.get_targets()[0]})},
+        cfg.epi.nfields, ins.nrecords());
+  }
+
+  /*
+  * Builds the record linkage component of the circuit, which calculates the
+  * linkage results of all records at once.
+  */
+  LinkageShares<MultShare> build_linkage_component() {
+    get_logger()->trace("Building linkage circuit component...");
+
+    // 1.-3. Best score of all field weight sums and its index
+    const auto max_fw_and_index = best_match();
     const auto max_field_weight = max_fw_and_index.get_selector();
     const auto max_idx = max_fw_and_index.get_targets();
 
     // 4. Set two comparison bits, whether field-weight-sum > (tentative) threshold * weight-sum
-    BoolShare threshold_weight = to_logic_space(ins.const_threshold() * max_field_weight.den);
-    BoolShare tthreshold_weight = to_logic_space(ins.const_tthreshold() * max_field_weight.den);
-    BoolShare b_sum_field_weight = to_logic_space(max_field_weight.num);
-    BoolShare match = threshold_weight < b_sum_field_weight;
-    BoolShare tmatch = tthreshold_weight < b_sum_field_weight;
+    auto [match, tmatch] = threshold_matches(max_field_weight,
+        ins.const_threshold(), ins.const_tthreshold());
 #ifdef DEBUG_SEL_CIRCUIT
-    print_share(max_field_weight, format("[{}] best score", index));
-    print_share(max_idx[0], format("[{}] index of best score", index));
-    print_share(threshold_weight, format("[{}] T*W", index));
-    print_share(tthreshold_weight, format("[{}] Tt*W", index));
-    print_share(match, format("[{}] match?", index));
-    print_share(tmatch, format("[{}] tentative match?", index));
+    print_share(max_field_weight, "best score");
+    print_share(max_idx[0], "index of best score");
+    print_share(match, "match?");
+    print_share(tmatch, "tentative match?");
 #endif
 
-    get_logger()->trace("Linkage circuit component {} built.", index);
+    get_logger()->trace("Linkage circuit component built.");
 
 #ifdef DEBUG_SEL_RESULT
     return {move(max_idx[0]), move(match), move(tmatch),
@@ -269,92 +551,297 @@ private:
 #endif // end ifdef DEBUG_SEL_RESULT
   }
 
-  CountOutputShares sum_linkage_shares(std::vector<LinkageShares<MultShare>> ls) {
+  /**
+   * Compares the field-weight-sums of the given scores with the (tentative)
+   * threshold times the weight-sums. The threshold constants must have the
+   * same number of values as the scores. Returns the match and tentative match
+   * bits.
+   */
+  pair<BoolShare, BoolShare> threshold_matches(const QuotientShare& scores,
+      const MultShare& threshold, const MultShare& tthreshold) {
+    // Both sides fit into threshold_bits(), so the comparisons only run on
+    // these instead of the full bitlen.
+    const auto bits = threshold_bits();
+    BoolShare threshold_weight = to_logic_space(threshold * scores.den).with_bitlength(bits);
+    BoolShare tthreshold_weight = to_logic_space(tthreshold * scores.den).with_bitlength(bits);
+    BoolShare b_sum_field_weight = to_logic_space(scores.num);
+    if (cfg.division_free_dice) {
+      // Numerator isn't scaled by dice precision in division-free mode
+      b_sum_field_weight = b_sum_field_weight << cfg.dice_prec;
+    }
+    b_sum_field_weight = b_sum_field_weight.with_bitlength(bits);
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(threshold_weight, "T*W");
+    print_share(tthreshold_weight, "Tt*W");
+#endif
+    return {threshold_weight < b_sum_field_weight, tthreshold_weight < b_sum_field_weight};
+  }
+
+  /**
+   * Counting circuit: whether each record has a (tentative) match in the
+   * database, including all previous chunks in streaming mode. Returns the
+   * match and tentative match bits of all records, nrecords values each.
+   *
+   * A record matches iff its best score exceeds the threshold, that is, iff the
+   * score of any database row exceeds the threshold. So instead of folding the
+   * scores with the costly tie-aware quotient comparison, each row's score is
+   * compared to the thresholds and the comparison bits are OR-accumulated.
+   */
+  pair<BoolShare, BoolShare> any_matches() {
+    const BinaryOp<BoolShare> op_or = [](auto a, auto b) { return a | b; };
+    const auto threshold = mult_constant(ins.threshold(), ins.nvals());
+    const auto tthreshold = mult_constant(ins.tthreshold(), ins.nvals());
+
     vector<BoolShare> matches, tmatches;
-    const auto n = ls.size();
-    matches.reserve(n);
-    tmatches.reserve(n);
-    for (auto& l : ls) {
-      matches.emplace_back(l.match);
-      tmatches.emplace_back(l.tmatch);
+    matches.reserve(ins.nclient_entries());
+    tmatches.reserve(ins.nclient_entries());
+    for (size_t index = 0; index != ins.nclient_entries(); ++index) {
+      const auto [row_match, row_tmatch] = threshold_matches(score(index),
+          threshold, tthreshold);
+      matches.emplace_back(contiguous_accumulate(row_match, op_or, ins.nsegments()));
+      tmatches.emplace_back(contiguous_accumulate(row_tmatch, op_or, ins.nsegments()));
     }
+    BoolShare match = vcombine(matches), tmatch = vcombine(tmatches);
 
-    return {out(to_gmw(sum(matches)), ALL), out(to_gmw(sum(tmatches)), ALL)};
+    // In streaming mode, include the matches of the previous chunks
+    if (ins.chunk_offset() != 0) {
+      assert (running_count);
+      match = match | in_running_best(running_count->match, 1);
+      tmatch = tmatch | in_running_best(running_count->tmatch, 1);
+    }
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(match, "any match?");
+    print_share(tmatch, "any tentative match?");
+#endif
+    return {match, tmatch};
+  }
+
+  /**
+   * Outputs the number of set bits in given share of nrecords match bits to
+   * all parties.
+   */
+  OutShare count_matches(const BoolShare& bits) {
+    return out(to_gmw(ins.nrecords() == 1 ? bits : sum(bits.split(1))), ALL);
   }
 
   /**
    * Bit-usage of nfields many weights summed up
+   * In division-free dice mode, we add the bits of the largest possible common
+   * denominator.
    */
   size_t weight_sum_bits(size_t nfields) {
-      return cfg.weight_prec + ceil_log2(nfields);
+      return cfg.weight_prec + ceil_log2(nfields)
+        + (cfg.division_free_dice ? cfg.dice_scale_bits() : 0);
   }
 
-  auto max_quotient(const vector<QuotientShare>& quotients,
-      size_t nfields) {
-    __ignore(nfields);
-    if constexpr (do_arith_mult) {
-      return max_tie(quotients, to_bool_closure, to_arith_closure, weight_sum_bits(nfields));
-    } else {
-      return max_tie(quotients);
-    }
+  /**
+   * Bit-usage of the sum of nfields many field weights, which are additionally
+   * scaled by the dice precision unless in division-free dice mode
+   */
+  size_t field_weight_sum_bits(size_t nfields) {
+    return weight_sum_bits(nfields) + (cfg.division_free_dice ? 0 : cfg.dice_prec);
   }
 
-  auto max_index(QuotientShare&& field_weights) {
-    return max_targets(forward<QuotientShare>(field_weights), {ins.const_idx()}, cfg.epi.nfields);
+  /**
+   * Bit-usage of both sides of the threshold comparisons, capped at bitlen:
+   * the threshold times the weight-sum on the one, the field-weight-sum scaled
+   * to dice precision on the other side.
+   */
+  uint32_t threshold_bits() {
+    return min(cfg.bitlen, cfg.dice_prec + 1 + weight_sum_bits(cfg.epi.nfields));
   }
 
-  auto max_targets(QuotientShare&& quotients, vector<BoolShare>&& targets, size_t nfields) {
-    __ignore(nfields);
+  auto max_targets(QuotientShare&& quotients, vector<BoolShare>&& targets,
+      size_t nfields, size_t nsegments = 1,
+      typename MultQuotientFolder::SegmentLayout layout =
+        MultQuotientFolder::SegmentLayout::INTERLEAVED,
+      optional<size_t> tie_target = nullopt) {
     MultQuotientFolder folder(forward<QuotientShare>(quotients),
         MultQuotientFolder::FoldOp::MAX_TIE, forward<vector<BoolShare>>(targets));
+    folder.set_segments(nsegments, layout);
+    if (tie_target) folder.set_tie_target(*tie_target);
     if constexpr (do_arith_mult) {
-      folder.set_converters_and_den_bits(&to_bool_closure, &to_arith_closure,
-          weight_sum_bits(nfields));
+      folder.set_converters_and_den_bits(&to_bool_closure, &to_arith_closure);
     }
+    folder.set_bitlengths(field_weight_sum_bits(nfields), weight_sum_bits(nfields));
     return folder.fold();
   }
 
-  FieldWeight<MultShare> best_group_weight(size_t index, const IndexSet& group_set) {
-    vector<FieldName> group{begin(group_set), end(group_set)};
-    // copy group to store permutations
-    vector<FieldName> groupPerm = group;
-    size_t size = group.size();
-
-    vector<QuotientShare> perm_weights; // where we store all weights before max
-    perm_weights.reserve(factorial<size_t>(size));
-    // iterate over all group permutations and calc field-weight
-    do {
-      vector<FieldWeight<MultShare>> field_weights;
-      field_weights.reserve(size);
-      for (size_t i = 0; i != size; ++i) {
-        const auto& ileft = group[i];
-        const auto& iright = groupPerm[i];
-        field_weights.emplace_back(field_weight({index, ileft, iright}));
+  /**
+   * Best field weight of all permutations of the exchange group. The field
+   * weights of all permutations are vertically combined position by position,
+   * so that all permutation sums are computed in a single SIMD share of
+   * nperms*nvals values, block p holding permutation p. The maximum over the
+   * permutations is then a single fold over these blocks.
+   */
+  FieldWeight<MultShare> best_group_weight(size_t index,
+      const ExchangeGroupPlan& xplan) {
+    const auto& group = xplan.group;
+    const size_t size = group.size();
+
+    // All permutations have the same left field at each position, so either
+    // all or none of a position's field weights are scaled
+    vector<FieldWeight<MultShare>> position_weights;
+    position_weights.reserve(size);
+    for (size_t i = 0; i != size; ++i) {
+      vector<MultShare> fws, ws, scales;
+      for (const auto& groupPerm : xplan.permutations) {
+        const auto& fweight = field_weight({index, group[i], groupPerm[i]});
+        fws.emplace_back(fweight.fw);
+        ws.emplace_back(fweight.w);
+        if (fweight.scale) scales.emplace_back(fweight.scale);
       }
-      // sum all field-weights for this permutation
-      QuotientShare sum_perm_weight = sum(field_weights);
+      position_weights.push_back({vcombine(fws), vcombine(ws),
+          scales.empty() ? MultShare{} : vcombine(scales)});
+    }
+    // sum all field-weights of all permutations at once
+    const auto perm_weights = sum(position_weights);
+    const size_t nvals = perm_weights.fw.get_nvals() / xplan.permutations.size();
 #ifdef DEBUG_SEL_CIRCUIT
-      print_share(sum_perm_weight,
-                  format("[{}] sum_perm_weight ({}|{})", index, group, groupPerm));
+    print_share(perm_weights, format("[{}] perm_weights ({})", index, group));
 #endif
-      // collect for later max
-      perm_weights.emplace_back(sum_perm_weight);
-    } while (next_permutation(groupPerm.begin(), groupPerm.end()));
 
-    auto max_perm_weight = max_quotient(perm_weights, weight_sum_bits(size));
+    auto max_perm_weight = max_permutation(perm_weights, nvals, size);
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(max_perm_weight, format("[{}] max_perm_weight ({})", index, group));
+#endif
+    return max_perm_weight;
+  }
+
+  /**
+   * Greedy assignment of the exchange group's fields, see
+   * CircuitConfig::greedy_exchange_group(). The field weights of all n*n pairs
+   * (left i, right j) are vertically combined in blocks c = i*n+j. In each of
+   * the n rounds, the pairs are compared by their weighted comparison fw/scale
+   * in a single fold, pairs with an already assigned field being masked to
+   * zero. The chosen pair's field weight is selected as fold target, together
+   * with its fields, which are then marked as assigned.
+   * Ties of equal weighted comparisons are broken by the larger weight w and
+   * then by the first pair in order of (left, right), like in
+   * clear_epilink::greedy_group_weight(). This order is the fold's tie target,
+   * the pair's weight concatenated with its inverted field indices.
+   */
+  FieldWeight<MultShare> greedy_group_weight(size_t index,
+      const ExchangeGroupPlan& xplan) {
+    const auto& group = xplan.group;
+    const size_t n = group.size();
+    const size_t npairs = n*n;
+
+    vector<MultShare> fws, ws, scales;
+    for (const auto ileft : group) {
+      for (const auto iright : group) {
+        const auto& fweight = field_weight({index, ileft, iright});
+        fws.emplace_back(fweight.fw);
+        ws.emplace_back(fweight.w);
+        if (fweight.scale) scales.emplace_back(fweight.scale);
+      }
+    }
+    const size_t nvals = fws.front().get_nvals();
+    const bool scaled = !scales.empty();
+    const MultShare fw = vcombine(fws);
+    const MultShare den = scaled ? vcombine(scales) : mult_constant(1, npairs * nvals);
+    // fw/den + 1, so that unassigned pairs are always preferred over masked ones
+    const MultShare key = fw + den;
+
+    // Fold targets: fields of pair and its field weight
+    const size_t field_bits = ceil_log2_min1(n);
+    const BoolShare left_field = ascending_numbers_constant(bcirc, n, 0, n * nvals, field_bits);
+    const BoolShare right_field = vcombine(vector<BoolShare>(n,
+          ascending_numbers_constant(bcirc, n, 0, nvals, field_bits)));
+    const BoolShare w = to_logic_space(vcombine(ws));
+    vector<BoolShare> targets{left_field, right_field, to_logic_space(fw), w};
+    if (scaled) targets.emplace_back(to_logic_space(den));
+    // Tie target: (w, ~left, ~right) with the least significant wire first
+    const size_t tie_target = targets.size();
+    vector<uint32_t> tie_wires;
+    for (const auto& part : {~right_field, ~left_field, w}) {
+      const auto wires = part.get()->get_wires();
+      tie_wires.insert(tie_wires.end(), wires.cbegin(), wires.cend());
+    }
+    targets.emplace_back(bcirc, tie_wires);
+
+    // Assigned fields, null if not yet assigned in any round
+    vector<BoolShare> left_used(n), right_used(n);
+    vector<FieldWeight<MultShare>> assigned;
+    assigned.reserve(n);
+    for (size_t round = 0; round != n; ++round) {
+      MultShare masked_key = key;
+      if (round) {
+        vector<BoolShare> left_used_pairs, right_used_pairs;
+        for (size_t c = 0; c != npairs; ++c) {
+          left_used_pairs.emplace_back(left_used[c/n]);
+          right_used_pairs.emplace_back(right_used[c%n]);
+        }
+        const BoolShare valid = ~(vcombine(left_used_pairs) | vcombine(right_used_pairs));
+        if constexpr (do_arith_mult) {
+          masked_key = to_mult_space(valid) * key;
+        } else {
+          masked_key = valid.mux(key,
+              constant_simd(bcirc, 0u, key.get_bitlen(), npairs * nvals));
+        }
+      }
+
+      auto best = max_targets({masked_key, den}, vector<BoolShare>(targets), n, nvals,
+          MultQuotientFolder::SegmentLayout::INTERLEAVED, tie_target);
+      const auto best_targets = best.get_targets();
+      assigned.push_back({to_mult_space(best_targets[2]), to_mult_space(best_targets[3]),
+          scaled ? to_mult_space(best_targets[4]) : MultShare{}});
 #ifdef DEBUG_SEL_CIRCUIT
-    print_share(max_perm_weight,
-                format("[{}] max_perm_weight ({})", index, group));
+      print_share(assigned.back(), format("[{}] greedy round {} ({})", index, round, group));
 #endif
-    // Treat quotient as FieldWeight
-    return {move(max_perm_weight.num), move(max_perm_weight.den)};
+      if (round + 1 == n) break;
+
+      for (size_t i = 0; i != n; ++i) {
+        const BoolShare field_i = constant_simd(bcirc, i, field_bits, nvals);
+        const BoolShare left_i = best_targets[0] == field_i;
+        const BoolShare right_i = best_targets[1] == field_i;
+        left_used[i] = left_used[i].is_null() ? left_i : left_used[i] | left_i;
+        right_used[i] = right_used[i].is_null() ? right_i : right_used[i] | right_i;
+      }
+    }
+
+    return sum(assigned);
+  }
+
+  MultShare mult_constant(CircUnit value, size_t nvals) {
+    if constexpr (do_arith_mult) {
+      return constant_simd(acirc, value, cfg.bitlen, nvals);
+    } else {
+      return constant_simd(bcirc, value, cfg.bitlen, nvals);
+    }
+  }
+
+  /**
+   * Selects the maximum of the given field weights as quotients fw/w, together
+   * with its scale if scaled. The field weights consist of consecutive blocks
+   * of nvals values, each value being its own segment of the fold.
+   */
+  FieldWeight<MultShare> max_permutation(const FieldWeight<MultShare>& fweights,
+      size_t nvals, size_t nfields) {
+    vector<BoolShare> targets;
+    if (fweights.scale) targets.emplace_back(to_logic_space(fweights.scale));
+    const auto best = max_targets({fweights.fw, fweights.w}, move(targets),
+        nfields, nvals);
+    const auto q = best.get_selector();
+    if (!fweights.scale) return {q.num, q.den, {}};
+    return {q.num, q.den, to_mult_space(best.get_targets()[0])};
   }
 
   /**
    * Cache to store calls to field_weight()
    * Can save half the circuit in permutation groups this way.
+   * Indexed by (left_idx, left, right) of the ComparisonIndex, sized on first
+   * use after each reset.
    */
-  std::map<ComparisonIndex, FieldWeight<MultShare>> field_weight_cache;
+  vector<optional<FieldWeight<MultShare>>> field_weight_cache;
+
+  optional<FieldWeight<MultShare>>& field_weight_cache_entry(const ComparisonIndex& i) {
+    const size_t nfields = cfg.field_names.size();
+    if (field_weight_cache.empty()) {
+      field_weight_cache.resize(ins.nclient_entries() * nfields * nfields);
+    }
+    return field_weight_cache[(i.left_idx * nfields + i.left) * nfields + i.right];
+  }
 
   /**
    * Calculates the field weight and addend to the total weight.
@@ -368,13 +855,20 @@ private:
    */
   const FieldWeight<MultShare>& field_weight(const ComparisonIndex& i) {
     // Probe cache
-    const auto& cache_hit = field_weight_cache.find(i);
-    if (cache_hit != field_weight_cache.cend()) {
+    auto& cache_entry = field_weight_cache_entry(i);
+    if (cache_entry) {
       get_logger()->trace("field_weight cache hit for {}", i);
-      return cache_hit->second;
+      return *cache_entry;
     }
 
     const auto delta_weight = weight(i);
+    if (cfg.division_free_dice
+        && cfg.field_specs[i.left].comparator == FieldComparator::DICE) {
+      const auto dice = dice_quotient(i);
+      return cache_entry.emplace(
+        FieldWeight<MultShare>{delta_weight * dice.num, delta_weight * dice.den, dice.den});
+    }
+
     const auto comp = compare(i);
 
     MultShare field_weight = delta_weight * comp;
@@ -386,11 +880,18 @@ private:
     //print_share(field_weight, format("^^^^ field weight ({}){} ^^^^", ftype, i));
 #endif
 
-    return field_weight_cache[i] = {field_weight, delta_weight};
+    return cache_entry.emplace(FieldWeight<MultShare>{field_weight, delta_weight});
   }
 
   MultShare weight(const ComparisonIndex& i) {
-    return delta(i) * ins.get_const_weight(i); // Arith: free constant multiplication
+    if constexpr (do_arith_mult) {
+      return delta(i) * ins.get_const_weight(i); // Arith: free constant multiplication
+    } else {
+      // delta is a single bit, so a mux saves the full-width multiplication
+      const BoolShare const_weight = ins.get_const_weight(i);
+      return delta(i).mux(const_weight, constant_simd(bcirc, 0u,
+            const_weight.get_bitlen(), const_weight.get_nvals()));
+    }
   }
 
   MultShare delta(const ComparisonIndex& i) {
@@ -408,10 +909,60 @@ private:
    * the field comparator type
    */
   MultShare compare(const ComparisonIndex& i) {
-    const auto ftype = cfg.epi.fields.at(i.left).comparator;
+    const auto ftype = cfg.field_specs[i.left].comparator;
     return (ftype == FieldComparator::DICE) ?  dice_coefficient(i) : equality(i);
   }
 
+  /**
+   * hw_size(bitsize) + 1 because we multiply numerator with 2 and denominator
+   * is sum of two values of original bitsize. Both are hammingweights.
+   */
+  static size_t int_div_bitsize(size_t field_bitsize) {
+    return hw_size(field_bitsize) + 1;
+  }
+
+  /**
+   * Hammingweight of a bitmask. In GMW, every AND layer costs a communication
+   * round, so the depth-optimized gadget is used.
+   */
+  BoolShare bitmask_hammingweight(const BoolShare& bits) const {
+    return (bcirc->GetContext() == S_BOOL) ? low_depth_hammingweight(bits)
+      : hammingweight(bits);
+  }
+
+  /**
+   * Hammingweight of a bitmask in arithmetic space, see
+   * CircuitConfig::arith_hammingweight: All bits are vertically combined into
+   * a single-bit share, converted at once and the converted bits summed up.
+   */
+  ArithShare arith_hammingweight(const BoolShare& bits) {
+    const auto nvals = bits.get_nvals();
+    const auto wires = bits.get()->get_wires();
+    vector<BoolShare> single_bits;
+    single_bits.reserve(wires.size());
+    for (const auto wire : wires) {
+      single_bits.emplace_back(bcirc, vector<uint32_t>{wire});
+    }
+    return sum(to_arith(vcombine(single_bits)).split(nvals));
+  }
+
+  string int_div_file_path(size_t bitsize) const {
+    return format((cfg.circ_dir/"sel_int_div/{}_{}.aby").string(),
+        bitsize, cfg.dice_prec);
+  }
+
+  /**
+   * Loads the division circuits of all bitmask fields into the CircuitFile
+   * cache, so that building the dice coefficients doesn't touch the disk.
+   */
+  void preload_int_div_circuits() const {
+    if (cfg.division_free_dice) return;
+    for (const auto& field : cfg.epi.fields) {
+      if (field.second.comparator != FieldComparator::DICE) continue;
+      CircuitFile::get(int_div_file_path(int_div_bitsize(field.second.bitsize)));
+    }
+  }
+
   /**
   * Calculates dice coefficient of given bitmasks via their hamming weights, up
   * to the configured precision.
@@ -423,15 +974,12 @@ private:
     const auto [client_entry, server_entry] = ins.get(i);
 
     const BoolShare hw_plus = client_entry.hw + server_entry.hw; // denominator
-    const BoolShare hw_and_twice = hammingweight(server_entry.val & client_entry.val) << 1; // numerator
+    const BoolShare hw_and_twice = bitmask_hammingweight(server_entry.val & client_entry.val) << 1; // numerator
 
     // fixed point rounding integer division
-    // hw_size(bitsize) + 1 because we multiply numerator with 2 and denominator is sum
-    // of two values of original bitsize. Both are hammingweights.
-    const auto bitsize = hw_size(cfg.epi.fields.at(i.left).bitsize) + 1;
-    const auto int_div_file_path = format((cfg.circ_dir/"sel_int_div/{}_{}.aby").string(),
-        bitsize, cfg.dice_prec);
-    const BoolShare dice = apply_file_binary(hw_and_twice, hw_plus, bitsize, bitsize, int_div_file_path);
+    const auto bitsize = int_div_bitsize(cfg.field_specs[i.left].bitsize);
+    const BoolShare dice = apply_file_binary(hw_and_twice, hw_plus, bitsize,
+        bitsize, int_div_file_path(bitsize));
 
 #ifdef DEBUG_SEL_CIRCUIT
     print_share(hw_and_twice, format("hw_and_twice {}", i));
@@ -442,6 +990,48 @@ private:
     return to_mult_space(dice);
   }
 
+  /**
+   * Division-free dice coefficient as quotient 2*hw(a&b) / (hw(a) + hw(b)).
+   * The denominator is set to 1 if any field is empty or the hammingweight sum
+   * is 0, so that it can be used as scale of the field weight.
+   */
+  QuotientShare dice_quotient(const ComparisonIndex& i) {
+    const auto [client_entry, server_entry] = ins.get(i);
+
+    const BoolShare hw_plus = client_entry.hw + server_entry.hw;
+    const BoolShare common_bits = server_entry.val & client_entry.val;
+    MultShare hw_and_twice;
+    if constexpr (do_arith_mult) {
+      if (cfg.arith_hammingweight) {
+        const ArithShare hw_and = arith_hammingweight(common_bits);
+        hw_and_twice = hw_and + hw_and;
+      }
+    }
+    if (!hw_and_twice) hw_and_twice = to_mult_space(bitmask_hammingweight(common_bits) << 1);
+
+    const auto nvals = hw_plus.get_nvals();
+    const auto bits = hw_plus.get_bitlen();
+    const BoolShare b_one = constant_simd(bcirc, 1u, bits, nvals);
+    const BoolShare hw_plus_zero = hw_plus == constant_simd(bcirc, 0u, bits, nvals);
+
+    MultShare den;
+    if constexpr (do_arith_mult) {
+      // delta ? den : 1 = delta*den + 1 - delta
+      const ArithShare delta_ = delta(i);
+      const ArithShare a_one = constant_simd(acirc, 1u, cfg.bitlen, nvals);
+      den = delta_ * to_arith(hw_plus_zero.mux(b_one, hw_plus)) + a_one - delta_;
+    } else {
+      den = (delta(i) & ~hw_plus_zero).mux(hw_plus, b_one);
+    }
+
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(hw_and_twice, format("hw_and_twice {}", i));
+    print_share(den, format("dice scale {}", i));
+#endif
+
+    return {hw_and_twice, den};
+  }
+
   /**
   * Binary-compares two shares
   */
@@ -451,6 +1041,8 @@ private:
 #ifdef DEBUG_SEL_CIRCUIT
     print_share(cmp, format("equality {}", i));
 #endif
+    // Without divisions, there's no dice precision to match
+    if (cfg.division_free_dice) return to_mult_space(cmp);
     if constexpr (do_arith_mult) {
     // For arithmetic multiplication:
     // Instead of left-shifting the bool share, it is cheaper to first do a
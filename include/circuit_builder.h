@@ -52,6 +52,33 @@ public:
   virtual std::vector<LinkageOutputShares> build_linkage_circuit() = 0;
   virtual CountOutputShares build_count_circuit() = 0;
 
+  /**
+   * Sets the version of the server database of the following inputs and
+   * whether the saved shares of this version are to be reused.
+   * See CircuitInput::set_database_version()
+   */
+  virtual void set_database_version(uint64_t version, bool reuse) = 0;
+  virtual std::optional<uint64_t> saved_database_version() const = 0;
+  /**
+   * Saves the shares of the newly input database. Call after circuit execution.
+   */
+  virtual void save_database_shares() = 0;
+
+  /**
+   * Streaming mode: Sets the following inputs to be the chunk of a database of
+   * total_size rows, starting at row offset. The best matches of this chunk are
+   * combined with the running best of the previous chunks, as saved by
+   * save_running_best(). Unless this is the last chunk, the circuit only
+   * outputs the new running best as shares and the build methods return empty
+   * output shares. A chunk at offset 0 starts a new running best.
+   */
+  virtual void set_database_chunk(size_t offset, size_t total_size) = 0;
+  /**
+   * Saves the running best of all chunks so far. Call after circuit execution
+   * of all but the last chunk.
+   */
+  virtual void save_running_best() = 0;
+
   virtual void reset() = 0;
 };
 
@@ -53,6 +53,13 @@ CircuitConfig::CircuitConfig(const EpilinkConfig& epi_,
       "matching_mode={}, bitlen={}, bool_sharing={}, use_conversion={}",
       epi, matching_mode, bitlen, bool_sharing, use_conversion);
 
+  field_names.reserve(epi.nfields);
+  field_specs.reserve(epi.nfields);
+  for (const auto& [name, spec] : epi.fields) {
+    field_names.push_back(name);
+    field_specs.push_back(spec);
+  }
+
 #ifndef SEL_MATCHING_MODE
     if (matching_mode) throw invalid_argument(
         "This SEL is compiled without matching mode (-DSEL_MATCHING_MODE)!");
@@ -71,11 +78,21 @@ CircuitConfig::CircuitConfig(const EpilinkConfig& epi_,
   get_logger()->trace("Constructed {}", *this);
 }
 
+/**
+ * In division-free mode, the score quotients are compared by
+ * cross-multiplication and the thresholds by T*den < num<<dice_prec.
+ */
+size_t division_free_bit_usage(const size_t dice_prec,
+    const size_t weight_prec, const size_t nfields, const size_t scale_bits) {
+  const size_t den_bits = weight_prec + ceil_log2(nfields) + scale_bits;
+  return max(2*den_bits, den_bits + dice_prec);
+}
+
 void CircuitConfig::set_precisions(size_t dice_prec_, size_t weight_prec_) {
   get_logger()->debug("Precisions changed to dice: {}; weight: {}",
       dice_prec_, weight_prec_);
 
-  if (bit_usage(dice_prec_, weight_prec_, epi.nfields) > bitlen) {
+  if (precision_bit_usage(dice_prec_, weight_prec_) > bitlen) {
     throw invalid_argument("Given dice and weight precision would potentially "
         "cause overflows in current bitlen!");
   }
@@ -84,7 +101,50 @@ void CircuitConfig::set_precisions(size_t dice_prec_, size_t weight_prec_) {
   weight_prec = weight_prec_;
 }
 
+size_t CircuitConfig::precision_bit_usage(size_t dice_prec_,
+    size_t weight_prec_) const {
+  return division_free_dice ?
+    division_free_bit_usage(dice_prec_, weight_prec_, epi.nfields, dice_scale_bits())
+    : bit_usage(dice_prec_, weight_prec_, epi.nfields);
+}
+
+void CircuitConfig::fit_bitlen(size_t dice_prec_, size_t weight_prec_) {
+  if (!dice_prec_ || !weight_prec_) {
+    throw invalid_argument(fmt::format("Both dice and weight precision need to "
+          "be set to fit the bitlen, got dice precision {} and weight precision {}!",
+          dice_prec_, weight_prec_));
+  }
+  const size_t usage = precision_bit_usage(dice_prec_, weight_prec_);
+  const auto ring_bitlen = find_if(RingBitLens.cbegin(), RingBitLens.cend(),
+      [usage](size_t b) { return usage <= b; });
+  if (ring_bitlen == RingBitLens.cend()) {
+    throw invalid_argument(fmt::format("Given dice and weight precision need "
+          "{} bits, which exceeds the maximum bitlen {}!", usage, BitLen));
+  }
+
+  bitlen = *ring_bitlen;
+  get_logger()->debug("Bitlen fitted to {} for bit usage {}", bitlen, usage);
+  set_precisions(dice_prec_, weight_prec_);
+}
+
 void CircuitConfig::set_ideal_precision() {
+  if (division_free_dice) {
+    // Both sides of the quotient comparison get half of the bits
+    const size_t den_bits_av = bitlen/2;
+    const size_t fixed_bits = ceil_log2(epi.nfields) + dice_scale_bits();
+    if (den_bits_av <= fixed_bits) {
+      throw invalid_argument(fmt::format("The common denominator of all dice "
+            "coefficients needs {} bits, which leaves no weight precision in "
+            "bitlen {}. Disable division-free dice or increase the bitlen.",
+            dice_scale_bits(), bitlen));
+    }
+    const size_t weight_prec = den_bits_av - fixed_bits;
+    // The thresholds don't need more than 16 bits of precision
+    const size_t dice_prec = min<size_t>(bitlen - den_bits_av, 16);
+    set_precisions(dice_prec, weight_prec);
+    return;
+  }
+
   size_t bits_av = bitlen - ceil_log2(epi.nfields*epi.nfields);
   size_t dice_prec = (bits_av)/3;
   size_t weight_prec = dice_prec;
@@ -99,6 +159,33 @@ void CircuitConfig::set_ideal_precision() {
   set_precisions(dice_prec, weight_prec);
 }
 
+void CircuitConfig::set_division_free_dice(bool enable) {
+  division_free_dice = enable;
+  if (!enable) arith_hammingweight = false;
+  set_ideal_precision();
+}
+
+void CircuitConfig::set_arith_hammingweight(bool enable) {
+  if (enable && !division_free_dice) {
+    throw invalid_argument("Arithmetic hammingweights are only used for "
+        "division-free dice coefficients. Enable division-free dice first.");
+  }
+  if (enable && !use_conversion && !auto_sharing) {
+    throw invalid_argument("Arithmetic hammingweights need conversion to "
+        "arithmetic space. Enable use_conversion or auto_sharing.");
+  }
+  arith_hammingweight = enable;
+}
+
+size_t CircuitConfig::dice_scale_bits() const {
+  size_t bits{0};
+  for (const auto& f : epi.fields) {
+    // hammingweight sum of two bitmasks of this size
+    if (f.second.comparator == FieldComparator::DICE) bits += hw_size(f.second.bitsize) + 1;
+  }
+  return bits;
+}
+
 /*
  * Rescales the weights so that the maximum weight is the maximum element
  * of given precision bits, i.e., 0xff...
@@ -109,6 +196,15 @@ unsigned long long rescale_weight(Weight weight, size_t prec, Weight max_weight)
   return llround((weight/max_weight) * max_el);
 }
 
+FieldId CircuitConfig::field_id(const FieldName& name) const {
+  // field_names is sorted like the map it was taken from
+  const auto it = lower_bound(field_names.cbegin(), field_names.cend(), name);
+  if (it == field_names.cend() || *it != name) {
+    throw invalid_argument(fmt::format("Unknown field '{}'", name));
+  }
+  return distance(field_names.cbegin(), it);
+}
+
 CircUnit CircuitConfig::rescaled_weight(const FieldName& name) const {
   return rescale_weight(epi.fields.at(name).weight, weight_prec, epi.max_weight);
 }
@@ -118,6 +214,11 @@ CircUnit CircuitConfig::rescaled_weight(const FieldName& name1, const FieldName&
   return rescale_weight(weight, weight_prec, epi.max_weight);
 }
 
+CircUnit CircuitConfig::rescaled_weight(FieldId id1, FieldId id2) const {
+  const auto weight = (field_specs[id1].weight + field_specs[id2].weight)/2.0;
+  return rescale_weight(weight, weight_prec, epi.max_weight);
+}
+
 // rescale all weights to an integer, max weight being b111...
 vector<CircUnit> rescale_weights(const vector<Weight>& weights,
     size_t prec, Weight max_weight) {
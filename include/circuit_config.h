@@ -22,12 +22,18 @@
 
 #include "epilink_input.h"
 #include <filesystem>
+#include <array>
 
 namespace sel {
 
 using CircUnit = uint32_t;
 using VCircUnit = std::vector<CircUnit>;
 constexpr size_t BitLen = sizeof(CircUnit)*8;
+// Bitlengths of the arithmetic ring the SecureEpilinker supports. Values are
+// always stored as CircUnit, so BitLen is the maximum.
+constexpr std::array<size_t, 2> RingBitLens{16, BitLen};
+// Dense index of a field in the order of EpilinkConfig::fields
+using FieldId = size_t;
 
 enum class BooleanSharing { GMW = 0, YAO = 1 };
 
@@ -40,10 +46,60 @@ struct CircuitConfig {
   bool matching_mode = false;
   BooleanSharing bool_sharing = BooleanSharing::YAO;
   bool use_conversion = true;
+  /**
+   * Whether the SecureEpilinker chooses bool_sharing and use_conversion per
+   * circuit shape, predicting the runtime of each combination from the circuit
+   * statistics and the network between the parties, see
+   * SecureEpilinker::connect(). Both parties need to agree on this setting.
+   */
+  bool auto_sharing = false;
   size_t bitlen = BitLen;
+  /**
+   * Whether to evaluate all client records in a single SIMD circuit of width
+   * num_records*database_size instead of one circuit per record. Both parties
+   * need to agree on this setting.
+   */
+  bool batch_records = false;
+  /**
+   * Whether dice coefficients are kept as quotients instead of running the
+   * integer division circuit, see set_division_free_dice().
+   */
+  bool division_free_dice = false;
+  /**
+   * Maximum number of database records evaluated in a single circuit. Larger
+   * databases are streamed in chunks of this size, carrying a secret-shared
+   * running best from chunk to chunk, which bounds the memory usage of the
+   * circuit. 0 disables streaming. Both parties need to agree on this setting.
+   */
+  size_t database_chunk_size = 0;
+  /**
+   * Exchange groups of at least this many fields are assigned greedily instead
+   * of evaluating all factorial(size) permutations, see
+   * greedy_exchange_group(). 0 always evaluates all permutations. Both parties
+   * need to agree on this setting.
+   */
+  size_t greedy_exchange_group_size = 0;
+  /**
+   * Whether the numerators of division-free dice coefficients are computed in
+   * arithmetic space, if use_conversion is set: Each bit of the AND-ed
+   * bitmasks is converted on its own, which costs one OT per bit, and the
+   * converted bits are summed up without interaction. This trades the boolean
+   * hammingweight adder tree for a single conversion round. Enable with
+   * set_arith_hammingweight(), which validates the combination.
+   * Whether this pays off has not been measured yet. Compare
+   * `test_sel -c -D --arith-hw` against `test_sel -c -D` for the bitmask sizes
+   * in question before enabling it in production.
+   */
+  bool arith_hammingweight = false;
 
   // pre-calculated fields
   size_t dice_prec, weight_prec;
+  /**
+   * Field names and specs by dense field id, so that hot paths of circuit
+   * construction can index flat arrays instead of looking up names.
+   */
+  std::vector<FieldName> field_names;
+  std::vector<FieldSpec> field_specs;
 
   CircuitConfig(const EpilinkConfig& epi,
       const std::filesystem::path& circ_dir = "../data/circ",
@@ -59,6 +115,24 @@ struct CircuitConfig {
   */
   void set_precisions(size_t dice_prec_, size_t weight_prec_);
 
+  /**
+   * Sets the given precisions together with the smallest bitlen of
+   * RingBitLens that their bit usage fits into. Small configurations thus run
+   * on a narrower arithmetic ring, which shrinks all arithmetic
+   * multiplications and conversions. Throws if either precision is 0 or they
+   * don't fit into BitLen. Both parties need to agree on the precisions.
+   */
+  void fit_bitlen(size_t dice_prec_, size_t weight_prec_);
+
+  /**
+   * Enables or disables computing division-free dice numerators in arithmetic
+   * space, see arith_hammingweight. Throws if enabled without
+   * division-free dice or without conversion to arithmetic space, i.e.,
+   * neither use_conversion nor auto_sharing being set. In auto sharing mode, it
+   * only applies to the shapes for which conversion is chosen.
+   */
+  void set_arith_hammingweight(bool enable = true);
+
   /**
   * Set ideal precisions, equally distributing available bits to weight and
   * dice precision such that 2*wp + dp = bitlen - ceil_log2(n*n).
@@ -68,8 +142,52 @@ struct CircuitConfig {
   */
   void set_ideal_precision();
 
+  /**
+   * Enables or disables division-free dice coefficients and sets the ideal
+   * precisions for the chosen mode.
+   * In division-free mode, all field weights of a comparison are brought to
+   * the common denominator of all dice coefficients, that is, the product of
+   * all their hammingweight sums. The scores are thus exact up to the weight
+   * precision, but the common denominator takes dice_scale_bits() bits. Throws
+   * if the configuration's dice fields don't fit into bitlen.
+   * The dice precision is only used for the thresholds in this mode.
+   */
+  void set_division_free_dice(bool enable = true);
+
+  /**
+   * Bit-usage of the common denominator in division-free dice mode
+   */
+  size_t dice_scale_bits() const;
+
+  /**
+   * Whether an exchange group of given size is assigned greedily: In each of
+   * its size rounds, the pair of not yet assigned left and right fields with
+   * the highest weighted comparison w*c is assigned. This needs size^3
+   * instead of factorial(size)*size comparisons. It finds the best
+   * permutation if the best remaining pair of each round is part of it, and
+   * otherwise its sum of weighted comparisons is at least half of the best
+   * permutation's sum (the bound of greedy maximum-weight matching). As the
+   * score is the quotient of this sum by the sum of weights, the score may
+   * deviate accordingly if the fields' weights differ.
+   */
+  bool greedy_exchange_group(size_t size) const {
+    return greedy_exchange_group_size && size >= greedy_exchange_group_size;
+  }
+
+  /**
+   * Id of field of given name. Throws if there is no such field.
+   */
+  FieldId field_id(const FieldName&) const;
+
   CircUnit rescaled_weight(const FieldName&) const;
   CircUnit rescaled_weight(const FieldName&, const FieldName&) const;
+  CircUnit rescaled_weight(FieldId, FieldId) const;
+
+private:
+  /**
+   * Bit usage of given precisions in the current dice mode
+   */
+  size_t precision_bit_usage(size_t dice_prec_, size_t weight_prec_) const;
 };
 
 /**
@@ -102,10 +220,13 @@ struct formatter<sel::CircuitConfig> {
   auto format(const sel::CircuitConfig& conf, FormatContext &ctx) {
     auto out =  format_to(ctx.begin(),
         "CircuitConfig{{{}, mathing_mode={}, bitlen={}, "
-        "bool_sharing={}, use_conversion={}, "
-        "precisions{{dice={}, weight={}}}, rescaled_weights={{",
+        "bool_sharing={}, use_conversion={}, auto_sharing={}, batch_records={}, "
+        "division_free_dice={}, database_chunk_size={}, greedy_exchange_group_size={}, "
+        "arith_hammingweight={}, precisions{{dice={}, weight={}}}, rescaled_weights={{",
         conf.epi, conf.matching_mode, conf.bitlen,
-        conf.bool_sharing, conf.use_conversion,
+        conf.bool_sharing, conf.use_conversion, conf.auto_sharing, conf.batch_records,
+        conf.division_free_dice, conf.database_chunk_size,
+        conf.greedy_exchange_group_size, conf.arith_hammingweight,
         conf.dice_prec, conf.weight_prec
     );
     for (const auto& f : conf.epi.fields) {
@@ -21,6 +21,7 @@ using fmt::format;
 #include "circuit_input.h"
 #include "aby/gadgets.h"
 #include "util.h"
+#include "math.h"
 #include "logger.h"
 
 using namespace std;
@@ -30,12 +31,6 @@ namespace sel {
 constexpr auto BIN = FieldComparator::BINARY;
 constexpr auto BM = FieldComparator::DICE;
 
-bool operator<(const ComparisonIndex& l, const ComparisonIndex& r) {
-  return l.left_idx < r.left_idx
-    || (l.left_idx == r.left_idx && l.left < r.left)
-    || (l.left_idx == r.left_idx && l.left == r.left && l.right < r.right);
-}
-
 template <class CircT>
 constexpr CircT* typed_circ(BooleanCircuit* bcirc, ArithmeticCircuit* acirc) {
   if constexpr (is_same_v<CircT, BooleanCircuit>) {
@@ -58,7 +53,9 @@ void CircuitInput<MultShare>::set(const EpilinkClientInput& input) {
   assert(!input_set && "Input already set. Call clear() first if resetting.");
   set_constants(input.database_size, input.num_records);
   set_real_client_input(input);
-  set_dummy_server_input();
+  if (do_share_database() && reuse_db) set_saved_server_input();
+  else set_dummy_server_input();
+  output_database_shares();
   get_logger()->trace("SELCircuit inputs set (client only).");
   input_set = true;
 }
@@ -68,7 +65,9 @@ void CircuitInput<MultShare>::set(const EpilinkServerInput& input) {
   assert(!input_set && "Input already set. Call clear() first if resetting.");
   set_constants(input.database_size, input.num_records);
   set_dummy_client_input();
-  set_real_server_input(input);
+  if (do_share_database() && reuse_db) set_saved_server_input();
+  else set_real_server_input(input);
+  output_database_shares();
   get_logger()->trace("SELCircuit inputs set (server only).");
   input_set = true;
 }
@@ -94,50 +93,153 @@ void CircuitInput<MultShare>::clear() {
   left_shares.clear();
   right_shares.clear();
   weight_cache.clear();
+  const_idx_.reset();
+  db_out_shares.clear();
   dbsize_ = 0;
   nrecords_ = 0;
+  nvals_ = 0;
+  chunk_offset_ = 0;
+  total_dbsize_ = 0;
   input_set = false;
 }
 
+template <class MultShare>
+bool CircuitInput<MultShare>::do_share_database() const {
+  return db_version && bcirc->GetContext() == S_BOOL && !cfg.batch_records
+    && !is_chunked();
+}
+
+template <class MultShare>
+void CircuitInput<MultShare>::set_chunk(size_t offset, size_t total_size) {
+  assert(!input_set && "Set chunk before setting the input.");
+  chunk_offset_ = offset;
+  total_dbsize_ = total_size;
+}
+
+template <class MultShare>
+void CircuitInput<MultShare>::set_database_version(uint64_t version, bool reuse) {
+  assert(!input_set && "Set database version before setting the input.");
+  if (reuse && saved_db_version != version) {
+    throw runtime_error(fmt::format("Cannot reuse database shares of version {:x},"
+          " no shares of this version saved.", version));
+  }
+  db_version = version;
+  reuse_db = reuse;
+}
+
+template <class MultShare>
+void CircuitInput<MultShare>::output_database_shares() {
+  if (!do_share_database() || reuse_db) return;
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    const auto& entry = right_shares[id];
+    std::optional<OutShare> out_hw;
+    if (cfg.field_specs[id].comparator == BM) out_hw = out_shared(entry.hw);
+    db_out_shares.insert_or_assign(i,
+        EntryOutShares{out_shared(entry.val), out_shared(entry.delta), out_hw});
+  }
+}
+
+template <class MultShare>
+void CircuitInput<MultShare>::save_database_shares() {
+  if (db_out_shares.empty()) return;
+  saved_db.clear();
+  for (auto& [i, out_entry] : db_out_shares) {
+    auto& saved = saved_db[i];
+    saved.val = out_entry.val.get_clear_value_bytes();
+    if constexpr (do_arith_mult) {
+      saved.delta = out_entry.delta.get_clear_value_vec();
+    } else {
+      saved.delta = out_entry.delta.get_clear_value_bytes();
+    }
+    if (out_entry.hw) saved.hw = out_entry.hw->get_clear_value_bytes();
+  }
+  saved_db_version = db_version;
+  db_out_shares.clear();
+  get_logger()->debug("Saved shares of database version {:x}", *saved_db_version);
+}
+
+template <class MultShare>
+void CircuitInput<MultShare>::set_saved_server_input() {
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    const auto& f = cfg.field_specs[id];
+    auto& saved = saved_db.at(i);
+    check_vector_size(saved.val, bitbytes(f.bitsize) * dbsize_,
+        "saved database shares "s + i);
+
+    BoolShare val = shared_in(bcirc, saved.val.data(), f.bitsize, dbsize_);
+    MultShare delta = shared_in(mcirc, saved.delta.data(), delta_bitlen(), dbsize_);
+    BoolShare _hw;
+    if (f.comparator == BM) {
+      _hw = shared_in(bcirc, saved.hw.data(), hw_size(f.bitsize), dbsize_);
+    }
+    right_shares[id] = {move(val), move(delta), move(_hw)};
+  }
+  get_logger()->trace("Reusing saved shares of database version {:x}", *db_version);
+}
+
 template <class MultShare>
 ComparisonShares<MultShare> CircuitInput<MultShare>::get(const ComparisonIndex& i) const {
-  return {left_shares.at(i.left)[i.left_idx], right_shares.at(i.right)};
+  return {left_shares[i.left][i.left_idx], right_shares[i.right]};
+}
+
+template <class MultShare>
+const BoolShare& CircuitInput<MultShare>::const_idx() const {
+  if (const_idx_.is_null()) {
+    const_idx_ = ascending_numbers_constant(bcirc, dbsize_, chunk_offset_,
+        1, ceil_log2_min1(total_dbsize()));
+#ifdef DEBUG_SEL_CIRCUIT
+    print_share(const_idx_, "const_idx");
+#endif
+  }
+  return const_idx_;
 }
 
 template <class MultShare>
 const MultShare& CircuitInput<MultShare>::get_const_weight(const ComparisonIndex& i) const {
-  FieldNamePair ipair{i.left, i.right};
-  const auto& cache_hit = weight_cache.find(ipair);
-  if (cache_hit != weight_cache.cend()) {
+  auto& weight = weight_cache[i.left * cfg.field_names.size() + i.right];
+  if (!weight.is_null()) {
     get_logger()->trace("weight cache hit for ({}|{})", i.left, i.right);
-    return cache_hit->second;
+    return weight;
   }
 
   const CircUnit weight_r = cfg.rescaled_weight(i.left, i.right);
-  MultShare weight = constant_simd(mcirc, weight_r, BitLen, dbsize_);
-
-  return weight_cache[ipair] = weight;
+  return weight = constant_simd(mcirc, weight_r, cfg.bitlen, nvals_);
 }
 
 template <class MultShare>
 void CircuitInput<MultShare>::set_constants(size_t database_size, size_t num_records) {
   dbsize_ = database_size;
   nrecords_ = num_records;
-  const_idx_ = ascending_numbers_constant(bcirc, dbsize_);
+  nvals_ = cfg.batch_records ? nrecords_ * dbsize_ : dbsize_;
+  const size_t nfields = cfg.field_names.size();
+  left_shares.resize(nfields);
+  right_shares.resize(nfields);
+  weight_cache.resize(nfields * nfields);
+  if (chunk_offset_ + dbsize_ > total_dbsize()) {
+    throw invalid_argument(fmt::format("Database chunk {}+{} exceeds database size {}",
+          chunk_offset_, dbsize_, total_dbsize_));
+  }
+  const_idx_.reset();
 
   const_dice_prec_factor_ =
-    constant_simd(mcirc, (1 << cfg.dice_prec), BitLen, database_size);
+    constant_simd(mcirc, (1 << cfg.dice_prec), cfg.bitlen, nvals_);
 
-  CircUnit T = llround(cfg.epi.threshold * (1 << cfg.dice_prec));
-  CircUnit Tt = llround(cfg.epi.tthreshold * (1 << cfg.dice_prec));
+  const CircUnit T = threshold_ = llround(cfg.epi.threshold * (1 << cfg.dice_prec));
+  const CircUnit Tt = tthreshold_ = llround(cfg.epi.tthreshold * (1 << cfg.dice_prec));
 
   get_logger()->debug(
       "Rescaled threshold: {:x}/ tentative: {:x}", T, Tt);
 
-  const_threshold_ = constant(mcirc, T, BitLen);
-  const_tthreshold_ = constant(mcirc, Tt, BitLen);
+  if (nrecords_ == 1) {
+    const_threshold_ = constant(mcirc, T, cfg.bitlen);
+    const_tthreshold_ = constant(mcirc, Tt, cfg.bitlen);
+  } else {
+    const_threshold_ = constant_simd(mcirc, T, cfg.bitlen, nrecords_);
+    const_tthreshold_ = constant_simd(mcirc, Tt, cfg.bitlen, nrecords_);
+  }
 #ifdef DEBUG_SEL_CIRCUIT
-  print_share(const_idx_, "const_idx");
   print_share(const_dice_prec_factor_, "const_dice_prec_factor");
   print_share(const_threshold_, "const_threshold ");
   print_share(const_tthreshold_, "const_tthreshold ");
@@ -146,37 +248,39 @@ void CircuitInput<MultShare>::set_constants(size_t database_size, size_t num_rec
 
 template <class MultShare>
 void CircuitInput<MultShare>::set_real_client_input(const EpilinkClientInput& input) {
-  for (const auto& _f : cfg.epi.fields) {
-    const FieldName& i = _f.first;
-    left_shares[i] = make_client_entry_shares(input, i);
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    left_shares[id] = make_client_entry_shares(input, i);
   }
 }
 
 template <class MultShare>
 void CircuitInput<MultShare>::set_real_server_input(const EpilinkServerInput& input) {
-  for (const auto& _f : cfg.epi.fields) {
-    const FieldName& i = _f.first;
-    right_shares[i] = make_server_entries_share(input, i);
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    right_shares[id] = make_server_entries_share(input, i);
   }
 }
 
 template <class MultShare>
 void CircuitInput<MultShare>::set_dummy_client_input() {
-  for (const auto& _f : cfg.epi.fields) {
-    const FieldName& i = _f.first;
-    auto& entries = left_shares[i];
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    auto& entries = left_shares[id];
     entries.reserve(nrecords_);
     for (size_t j = 0; j != nrecords_; ++j) {
-      entries.emplace_back(make_dummy_entry_share(i));
+      entries.emplace_back(make_dummy_client_entry_share(i));
     }
+    // In batched mode, all records are contained in one entry share
+    if (cfg.batch_records) entries = {combine_entry_shares(entries)};
   }
 }
 
 template <class MultShare>
 void CircuitInput<MultShare>::set_dummy_server_input() {
-  for (const auto& _f : cfg.epi.fields) {
-    const FieldName& i = _f.first;
-    right_shares[i] = make_dummy_entry_share(i);
+  for (FieldId id = 0; id != cfg.field_names.size(); ++id) {
+    const FieldName& i = cfg.field_names[id];
+    right_shares[id] = make_dummy_entry_share(i);
   }
 }
 
@@ -184,28 +288,40 @@ template <class MultShare>
 EntryShare<MultShare> CircuitInput<MultShare>::make_server_entries_share(const EpilinkServerInput& input,
     const FieldName& i) {
   const auto& f = cfg.epi.fields.at(i);
-  const VFieldEntry& entries = input.database->at(i);
-  size_t bytesize = bitbytes(f.bitsize);
-  Bitmask dummy_bm(bytesize);
-  VBitmask values = transform_vec(entries,
-      [&dummy_bm](auto e){return e.value_or(dummy_bm);});
-  check_vectors_size(values, bytesize, "server input byte vector "s + i);
 
-  // value
-  BoolShare val(bcirc,
-      concat_vec(values).data(), f.bitsize, SERVER, dbsize_);
+  // Use columns of database snapshot if available
+  optional<FieldColumn> local_column;
+  const FieldColumn* column = nullptr;
+  if (input.columns) {
+    if (auto c = input.columns->find(i); c != input.columns->cend()) {
+      column = &c->second;
+    }
+  }
+  if (!column) {
+    if (!input.database) {
+      throw invalid_argument{format("Server input is missing field {}", i)};
+    }
+    column = &local_column.emplace(input.database->at(i), f);
+  }
+  if (column->bytesize != bitbytes(f.bitsize)) {
+    throw invalid_argument{format("Precomputed column of field {} has {} bytes "
+        "per value but field has bitsize {}", i, column->bytesize, f.bitsize)};
+  }
 
   // delta
   vector<CircUnit> db_delta(dbsize_);
-  for (size_t j=0; j!=dbsize_; ++j) db_delta[j] = entries[j].has_value();
-  MultShare delta(mcirc, db_delta.data(), delta_bitlen, SERVER, dbsize_);
+  for (size_t j=0; j!=dbsize_; ++j) db_delta[j] = column->has_value(j);
+
+  // value
+  BoolShare val(bcirc, column->values.data(), f.bitsize, SERVER, dbsize_);
+
+  MultShare delta(mcirc, db_delta.data(), delta_bitlen(), SERVER, dbsize_);
 
   // Set hammingweight input share only for bitmasks
   BoolShare _hw;
   if (f.comparator == BM) {
-    auto value_hws = transform_vec(values, hw);
     _hw = BoolShare(bcirc,
-        value_hws.data(), hw_size(f.bitsize), SERVER, dbsize_);
+        column->hws.data(), hw_size(f.bitsize), SERVER, dbsize_);
   }
 
 #ifdef DEBUG_SEL_CIRCUIT
@@ -214,13 +330,16 @@ EntryShare<MultShare> CircuitInput<MultShare>::make_server_entries_share(const E
     if (f.comparator == BM) print_share(_hw, format("server hw[{}]", i));
 #endif
 
-  return {move(val), move(delta), move(_hw)};
-
+  return widen_server_entry_share({move(val), move(delta), move(_hw)});
 }
 
 template <class MultShare>
 VEntryShare<MultShare> CircuitInput<MultShare>::make_client_entry_shares(
     const EpilinkClientInput& input, const FieldName& i) {
+  if (cfg.batch_records) {
+    return {make_batched_client_entry_share(input, i)};
+  }
+
   VEntryShare<MultShare> entry_shares;
   entry_shares.reserve(nrecords_);
   for (size_t j = 0; j != nrecords_; ++j) {
@@ -239,21 +358,17 @@ EntryShare<MultShare> CircuitInput<MultShare>::make_client_entry_share(const Epi
   check_vector_size(value, bytesize, "client input byte vector "s + i);
 
   // value
-  BoolShare val(bcirc,
-      repeat_vec(value, dbsize_).data(),
-      f.bitsize, CLIENT, dbsize_);
+  BoolShare val(bcirc, value.data(), f.bitsize, CLIENT, 1);
 
   // delta
-  MultShare delta(mcirc,
-      vector<CircUnit>(dbsize_, static_cast<CircUnit>(entry.has_value())).data(),
-      delta_bitlen, CLIENT, dbsize_);
+  CircUnit delta_value = entry.has_value();
+  MultShare delta(mcirc, &delta_value, delta_bitlen(), CLIENT, 1);
 
   // Set hammingweight input share only for bitmasks
   BoolShare _hw;
   if (f.comparator == BM) {
-    _hw = BoolShare(bcirc,
-        vector<CircUnit>(dbsize_, hw(value)).data(),
-        hw_size(f.bitsize), CLIENT, dbsize_);
+    CircUnit hw_value = hw(value);
+    _hw = BoolShare(bcirc, &hw_value, hw_size(f.bitsize), CLIENT, 1);
   }
 
 #ifdef DEBUG_SEL_CIRCUIT
@@ -262,7 +377,85 @@ EntryShare<MultShare> CircuitInput<MultShare>::make_client_entry_share(const Epi
     if (f.comparator == BM) print_share(_hw, format("client[{}] hw[{}]", index, i));
 #endif
 
-  return {move(val), move(delta), move(_hw)};
+  return widen_client_entry_share({move(val), move(delta), move(_hw)});
+}
+
+/**
+ * Creates the client's entry share of field i for all records at once. Each
+ * record is input once and repeated dbsize times, and the records are
+ * combined one after another, matching the record-major layout of the widened
+ * server entries share.
+ */
+template <class MultShare>
+EntryShare<MultShare> CircuitInput<MultShare>::make_batched_client_entry_share(
+    const EpilinkClientInput& input, const FieldName& i) {
+  VEntryShare<MultShare> entries;
+  entries.reserve(nrecords_);
+  for (size_t r = 0; r != nrecords_; ++r) {
+    entries.emplace_back(make_client_entry_share(input, i, r));
+  }
+  return combine_entry_shares(entries);
+}
+
+/**
+ * A single value is repeated with a repeater gate.
+ */
+template <class MultShare>
+template <class ShareT>
+ShareT CircuitInput<MultShare>::widen_client_share(ShareT s) const {
+  if (dbsize_ == 1) return s;
+  return s.repeat(dbsize_);
+}
+
+template <class MultShare>
+EntryShare<MultShare> CircuitInput<MultShare>::widen_client_entry_share(
+    EntryShare<MultShare>&& entry) const {
+  entry.val = widen_client_share(move(entry.val));
+  entry.delta = widen_client_share(move(entry.delta));
+  if (entry.hw) entry.hw = widen_client_share(move(entry.hw));
+  return move(entry);
+}
+
+/**
+ * The database is only input once. In batched mode, it is compared to all
+ * client records by combining nrecords copies of it, which costs no gates.
+ */
+template <class MultShare>
+EntryShare<MultShare> CircuitInput<MultShare>::widen_server_entry_share(
+    EntryShare<MultShare>&& entry) const {
+  if (!cfg.batch_records || nrecords_ == 1) return move(entry);
+  return combine_entry_shares(VEntryShare<MultShare>(nrecords_, entry));
+}
+
+template <class MultShare>
+EntryShare<MultShare> CircuitInput<MultShare>::combine_entry_shares(
+    const VEntryShare<MultShare>& entries) const {
+  if (entries.size() == 1) return entries.front();
+  vector<BoolShare> vals, hws;
+  vector<MultShare> deltas;
+  for (const auto& e : entries) {
+    vals.push_back(e.val);
+    deltas.push_back(e.delta);
+    if (e.hw) hws.push_back(e.hw);
+  }
+  return {vcombine(vals), vcombine(deltas),
+    hws.empty() ? BoolShare{} : vcombine(hws)};
+}
+
+template <class MultShare>
+EntryShare<MultShare> CircuitInput<MultShare>::make_dummy_client_entry_share(const FieldName& i) {
+  const auto& f = cfg.epi.fields.at(i);
+
+  BoolShare val(bcirc, f.bitsize, 1); //dummy val
+
+  MultShare delta(mcirc, delta_bitlen(), 1); // dummy delta
+
+  BoolShare _hw;
+  if (f.comparator == BM) {
+    _hw = BoolShare(bcirc, hw_size(f.bitsize), 1); //dummy hw
+  }
+
+  return widen_client_entry_share({move(val), move(delta), move(_hw)});
 }
 
 template <class MultShare>
@@ -271,7 +464,7 @@ EntryShare<MultShare> CircuitInput<MultShare>::make_dummy_entry_share(const Fiel
 
   BoolShare val(bcirc, f.bitsize, dbsize_); //dummy val
 
-  MultShare delta(mcirc, delta_bitlen, dbsize_); // dummy delta
+  MultShare delta(mcirc, delta_bitlen(), dbsize_); // dummy delta
 
   BoolShare _hw;
   if (f.comparator == BM) {
@@ -284,7 +477,7 @@ EntryShare<MultShare> CircuitInput<MultShare>::make_dummy_entry_share(const Fiel
     if (f.comparator == BM) print_share(_hw, format("dummy hw[{}]", i));
 #endif
 
-  return {move(val), move(delta), move(_hw)};
+  return widen_server_entry_share({move(val), move(delta), move(_hw)});
 }
 
 template class CircuitInput<BoolShare>;
@@ -20,6 +20,7 @@
 #define SEL_CIRCUIT_INPUT_H
 #pragma once
 
+#include <optional>
 #include "aby/Share.h"
 #include "seltypes.h"
 #include "circuit_config.h"
@@ -47,14 +48,9 @@ struct ComparisonShares {
 
 struct ComparisonIndex {
   size_t left_idx;
-  const FieldName left, right;
+  FieldId left, right;
 };
 
-// We want to use ComparisonIndex as map keys
-bool operator<(const ComparisonIndex& l, const ComparisonIndex& r);
-
-using FieldNamePair = std::pair<FieldName, FieldName>;
-
 template <class MultShare>
 class CircuitInput {
   public:
@@ -68,20 +64,75 @@ class CircuitInput {
 #endif
     void clear();
 
+    /**
+     * Sets the version of the server database of the following inputs.
+     * If reuse is set, the shares of the database saved by a previous run of
+     * the same version are input as shared inputs, instead of the server
+     * inputting its database again. Otherwise, the shares of the newly input
+     * database are output so that save_database_shares() can save them after
+     * the circuit was executed.
+     * This is only supported for GMW as main boolean sharing and without
+     * batched records, otherwise the database is always input.
+     * Both parties need to agree on version and reuse. They persist over
+     * clear() until set again.
+     */
+    void set_database_version(uint64_t version, bool reuse);
+    std::optional<uint64_t> saved_database_version() const { return saved_db_version; }
+    void save_database_shares();
+
+    /**
+     * Streaming mode: Sets the following server input to be the chunk of a
+     * database of total_size rows, starting at row offset. The constant
+     * indices then start at offset and have the bitlength needed for the whole
+     * database. Database shares are not saved or reused for chunks. Reset by
+     * clear().
+     */
+    void set_chunk(size_t offset, size_t total_size);
+    size_t chunk_offset() const { return chunk_offset_; }
+    bool is_chunked() const { return total_dbsize_ != 0; }
+    bool is_last_chunk() const { return chunk_offset_ + dbsize_ == total_dbsize(); }
+    size_t total_dbsize() const { return is_chunked() ? total_dbsize_ : dbsize_; }
+
     bool is_input_set() const { return input_set; }
     size_t dbsize() const { return dbsize_; }
     size_t nrecords() const { return nrecords_; }
+    /**
+     * SIMD width of all input shares. In batched mode, this is
+     * nrecords*dbsize, otherwise dbsize.
+     */
+    size_t nvals() const { return nvals_; }
+    /**
+     * Number of contiguous segments in the input shares, which need to be
+     * folded independently. In batched mode, value k = r*dbsize + j holds the
+     * comparison of client record r with database record j, so this is
+     * nrecords. Otherwise it is 1.
+     */
+    size_t nsegments() const { return cfg.batch_records ? nrecords_ : 1; }
+    /**
+     * Number of client entry shares per field, that is, the range of
+     * ComparisonIndex::left_idx. In batched mode, all records are contained
+     * in one entry share.
+     */
+    size_t nclient_entries() const { return cfg.batch_records ? 1 : nrecords_; }
     ComparisonShares<MultShare> get(const ComparisonIndex& i) const;
     const MultShare& get_const_weight(const ComparisonIndex& i) const;
-    const BoolShare& const_idx() const { return const_idx_; }
+    /**
+     * Database indices of the rows of the chunk, dbsize values. Only built on
+     * first use, as the counting circuit doesn't select any index.
+     */
+    const BoolShare& const_idx() const;
     const MultShare& const_dice_prec_factor() const { return const_dice_prec_factor_; }
+    // Threshold constants have nrecords() many values
     const MultShare& const_threshold() const { return const_threshold_; }
     const MultShare& const_tthreshold() const { return const_tthreshold_; }
+    // (Tentative) threshold, rescaled by the dice precision
+    CircUnit threshold() const { return threshold_; }
+    CircUnit tthreshold() const { return tthreshold_; }
 
   private:
     inline static constexpr bool do_arith_mult = std::is_same_v<MultShare, ArithShare>;
-    inline static constexpr size_t delta_bitlen = do_arith_mult ? BitLen : 1;
     using MultCircuit = std::conditional_t<do_arith_mult, ArithmeticCircuit, BooleanCircuit>;
+    size_t delta_bitlen() const { return do_arith_mult ? cfg.bitlen : 1; }
 
     const CircuitConfig& cfg;
     BooleanCircuit* bcirc;
@@ -91,28 +142,63 @@ class CircuitInput {
 
     size_t dbsize_{0};
     size_t nrecords_{0};
+    size_t nvals_{0};
+    size_t chunk_offset_{0};
+    size_t total_dbsize_{0};
     // Constant shares
-    BoolShare const_idx_;
+    mutable BoolShare const_idx_;
     MultShare const_dice_prec_factor_;
     // Left side of inequality: T * sum(weights)
+    CircUnit threshold_{0}, tthreshold_{0};
     MultShare const_threshold_, const_tthreshold_;
-    mutable std::map<FieldNamePair, MultShare> weight_cache;
+    // By left field id * nfields + right field id
+    mutable std::vector<MultShare> weight_cache;
+
+    // By field id
+    std::vector<VEntryShare<MultShare>> left_shares;
+    std::vector<EntryShare<MultShare>> right_shares;
+
+    // Persistent secret-shared database
+    using DeltaValues = std::conditional_t<do_arith_mult, VCircUnit, Bitmask>;
+    struct SavedEntry { Bitmask val; DeltaValues delta; Bitmask hw; };
+    struct EntryOutShares { OutShare val, delta; std::optional<OutShare> hw; };
+    std::optional<uint64_t> db_version;
+    bool reuse_db{false};
+    std::optional<uint64_t> saved_db_version;
+    std::map<FieldName, SavedEntry> saved_db;
+    std::map<FieldName, EntryOutShares> db_out_shares;
 
-    std::map<FieldName, VEntryShare<MultShare>> left_shares;
-    std::map<FieldName, EntryShare<MultShare>> right_shares;
+    bool do_share_database() const;
 
     void set_constants(size_t database_size, size_t num_records);
     void set_real_client_input(const EpilinkClientInput& input);
     void set_real_server_input(const EpilinkServerInput& input);
     void set_dummy_client_input();
     void set_dummy_server_input();
+    void set_saved_server_input();
+    void output_database_shares();
     EntryShare<MultShare> make_server_entries_share(const EpilinkServerInput& input,
         const FieldName& i);
     VEntryShare<MultShare> make_client_entry_shares(const EpilinkClientInput& input,
         const FieldName& i);
     EntryShare<MultShare> make_client_entry_share(const EpilinkClientInput& input,
         const FieldName& i, size_t index);
+    EntryShare<MultShare> make_batched_client_entry_share(
+        const EpilinkClientInput& input, const FieldName& i);
     EntryShare<MultShare> make_dummy_entry_share(const FieldName& i);
+    EntryShare<MultShare> make_dummy_client_entry_share(const FieldName& i);
+    /**
+     * Client records and the database are only input once and are widened to
+     * nvals inside the circuit: each client record to all database records,
+     * the database to all client records in batched mode.
+     */
+    template <class ShareT> ShareT widen_client_share(ShareT s) const;
+    EntryShare<MultShare> widen_client_entry_share(EntryShare<MultShare>&& entry) const;
+    EntryShare<MultShare> widen_server_entry_share(EntryShare<MultShare>&& entry) const;
+    /**
+     * Vertically combines the given entry shares one after another
+     */
+    EntryShare<MultShare> combine_entry_shares(const VEntryShare<MultShare>& entries) const;
 };
 
 } /* end of namespace: sel */
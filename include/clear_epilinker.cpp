@@ -17,6 +17,7 @@
 */
 
 #include <stdexcept>
+#include <cassert>
 #include <algorithm>
 #include <iostream>
 #include "util.h"
@@ -38,20 +39,29 @@ constexpr auto BM = FieldComparator::DICE;
  * field_weight() returns w_i*c_i in the member fw and the weight w_i in w.
  * A FieldWeight with w==0 is interpreted as if any entry in the comparison was
  * empty.
+ * In division-free dice mode, fw and w are scaled by the common denominator
+ * scale of all dice coefficients, which is 1 otherwise.
  */
 template<typename T>
 struct FieldWeight {
-  T fw{0}, w{0};
+  T fw{0}, w{0}, scale{1};
 };
 
 /**
  * When we add two FieldWeights in this context, we simply sum the field-weights
  * and weights. This happens before determining the maximum score.
+ * Scaled FieldWeights are first brought to their common denominator.
  */
 template<typename T>
 FieldWeight<T>& operator+=(FieldWeight<T>& me, const FieldWeight<T>& other) {
-  me.fw += other.fw;
-  me.w += other.w;
+  if (me.scale == 1 && other.scale == 1) {
+    me.fw += other.fw;
+    me.w += other.w;
+  } else {
+    me.fw = me.fw * other.scale + other.fw * me.scale;
+    me.w = me.w * other.scale + other.w * me.scale;
+    me.scale *= other.scale;
+  }
   return me;
 }
 
@@ -87,8 +97,8 @@ bool operator<(const FieldWeight<T>& left, const FieldWeight<T>& right) {
 
 /******************** Input Class ********************/
 Input::Input(const Record& record,
-        const VRecord& database) :
-  record{record}, database{database},
+        const VRecord& database, const FieldColumns* columns) :
+  record{record}, database{database}, columns{columns},
   dbsize{(*database.cbegin()).second.size()}
 {
   for (const auto& col : database) {
@@ -109,16 +119,17 @@ T scale(T val, size_t prec) {
 }
 
 /**
- * Dice coefficient of hamming weights
+ * Dice coefficient of hamming weights. The right bitmask is a view into a
+ * database column of the same size as left, right_hw being its hamming weight.
  * Note that for integral T, we use rounding integer division, that is
  * (x+(y/2))/y, because x/y always rounds down, which would lead to a bias.
  */
 template<typename T>
-T dice(const Bitmask& left, const Bitmask& right, size_t prec) {
-  T hw_plus = hw(left) + hw(right);
+T dice(const Bitmask& left, const BitmaskUnit* right, size_t right_hw, size_t prec) {
+  T hw_plus = hw(left) + right_hw;
   if (hw_plus == 0) return 0;
 
-  T hw_and = hw(bm_and(left, right));
+  T hw_and = bm_and_hw(left.data(), right, left.size());
   T numerator;
   if constexpr (is_integral_v<T>) {
     numerator = (hw_and << (prec+1)) + (hw_plus>>1);
@@ -133,21 +144,43 @@ T dice(const Bitmask& left, const Bitmask& right, size_t prec) {
 }
 
 template<typename T>
-T equality(const Bitmask& left, const Bitmask& right, size_t prec) {
-  return ((left == right) ? scale<T>(1, prec) : 0);
+T equality(const Bitmask& left, const BitmaskUnit* right, size_t prec) {
+  return (equal(left.cbegin(), left.cend(), right) ? scale<T>(1, prec) : 0);
 }
 
+/**
+ * Division-free dice coefficient as FieldWeight with given weight, scaled by
+ * the hammingweight sum
+ */
 template<typename T>
-bool test_threshold(const FieldWeight<T>& q, const double thr, const size_t prec) {
+FieldWeight<T> dice_quotient(const Bitmask& left, const BitmaskUnit* right,
+    size_t right_hw, const T weight) {
+  const T hw_plus = hw(left) + right_hw;
+  if (hw_plus == 0) return {0, weight, 1};
+  const T hw_and_twice = 2 * bm_and_hw(left.data(), right, left.size());
+  return {(T)(weight * hw_and_twice), (T)(weight * hw_plus), hw_plus};
+}
+
+template<typename T>
+bool test_threshold(const FieldWeight<T>& q, const double thr, const size_t prec,
+    const bool division_free) {
   T threshold;
   if constexpr (is_integral_v<T>) {
     threshold = llround(thr * (1 << prec));
+    // Sum of field weights isn't scaled by dice precision in division-free mode
+    if (division_free) return threshold * q.w < (T)(q.fw << prec);
   } else {
+    __ignore(division_free);
     threshold = thr;
   }
   return threshold * q.w < q.fw;
 }
 
+template<typename T> constexpr
+bool division_free(const CircuitConfig& cfg) {
+  return is_integral_v<T> && cfg.division_free_dice;
+}
+
 template<typename T>
 T scaled_weight(const FieldName& ileft, const FieldName& iright, const CircuitConfig& cfg) {
   if constexpr (is_integral_v<T>) {
@@ -164,32 +197,43 @@ FieldWeight<T> field_weight(const Input& input, const CircuitConfig& cfg,
   const FieldComparator ftype = cfg.epi.fields.at(ileft).comparator;
 
   // 1. Check if both entries have values
+  // Server entries are viewed in the database columns, see calc()
   const FieldEntry& client_entry = input.record.at(ileft);
-  const FieldEntry& server_entry = input.database.at(iright)[idx];
-  const bool delta = (client_entry.has_value() && server_entry.has_value());
+  const FieldColumn& server_column = input.columns->at(iright);
+  const bool delta = (client_entry.has_value() && server_column.has_value(idx));
   if (!delta){
 #ifdef DEBUG_SEL_CLEAR
     string who = "both";
     if (client_entry.has_value()) {
       who = "right";
-    } else if (server_entry.has_value()) {
+    } else if (server_column.has_value(idx)) {
       who = "left";
     }
     print("({}|{}|{})[{}] <{} empty>\n", ftype, ileft, iright, idx, who);
 #endif
     return {0, 0};
   }
+  assert(client_entry->size() == server_column.bytesize);
 
   const T weight = scaled_weight<T>(ileft, iright, cfg);
+  if (division_free<T>(cfg)) {
+    if (ftype == BM) {
+      return dice_quotient<T>(client_entry.value(), server_column.value(idx),
+          server_column.hws[idx], weight);
+    }
+    // Without divisions, there's no dice precision to match
+    return {(T)(equality<T>(client_entry.value(), server_column.value(idx), 0) * weight), weight};
+  }
   // 2. Compare values
   T comp;
   switch(ftype) {
     case BM: {
-      comp = dice<T>(client_entry.value(), server_entry.value(), cfg.dice_prec);
+      comp = dice<T>(client_entry.value(), server_column.value(idx),
+          server_column.hws[idx], cfg.dice_prec);
       break;
     }
     case BIN: {
-      comp = equality<T>(client_entry.value(), server_entry.value(), cfg.dice_prec);
+      comp = equality<T>(client_entry.value(), server_column.value(idx), cfg.dice_prec);
       break;
     }
   }
@@ -264,13 +308,69 @@ FieldWeight<T> best_group_weight(const Input& input, const CircuitConfig& cfg,
   return best_perm;
 }
 
+/**
+ * Greedy assignment of the group's fields, see
+ * CircuitConfig::greedy_exchange_group(). The pairs are compared by their
+ * weighted comparison fw/scale. Ties are broken by the larger weight w and then
+ * by the first pair in order of (left, right), exactly as in the circuit, so
+ * that both choose the same pairs.
+ */
+template<typename T>
+FieldWeight<T> greedy_group_weight(const Input& input, const CircuitConfig& cfg,
+    const size_t idx, const IndexSet& group_set) {
+  vector<FieldName> group{begin(group_set), end(group_set)};
+  const size_t n = group.size();
+
+  // Field weights of all pairs (left i, right j) at i*n+j
+  vector<FieldWeight<T>> pairs;
+  pairs.reserve(n*n);
+  for (const auto& ileft : group) {
+    for (const auto& iright : group) {
+      pairs.emplace_back(field_weight<T>(input, cfg, idx, ileft, iright));
+    }
+  }
+  const auto less = [](const FieldWeight<T>& l, const FieldWeight<T>& r) {
+    const T lx = l.fw * r.scale, rx = r.fw * l.scale;
+    return lx < rx || (lx == rx && l.w < r.w);
+  };
+
+  vector<bool> left_used(n), right_used(n);
+  FieldWeight<T> score;
+  for (size_t round = 0; round != n; ++round) {
+    size_t best = n*n;
+    for (size_t c = 0; c != n*n; ++c) {
+      if (left_used[c/n] || right_used[c%n]) continue;
+      if (best == n*n || less(pairs[best], pairs[c])) best = c;
+    }
+#ifdef DEBUG_SEL_CLEAR
+    print("Greedy round {}: ({}|{})\n", round, group[best/n], group[best%n]);
+#endif
+    score += pairs[best];
+    left_used[best/n] = right_used[best%n] = true;
+  }
+
+#ifdef DEBUG_SEL_CLEAR
+  print_score("Greedy group:", group, score, cfg.dice_prec);
+#endif
+
+  return score;
+}
+
 template<typename T>
 Result<T> calc(const Input& input, const CircuitConfig& cfg) {
-  // Check for integral types that cfg.bitlen matches the type's bitlength
+  // The algorithm works on database columns
+  if (!input.columns) {
+    const auto columns = make_field_columns(input.database, cfg.epi.fields);
+    return calc<T>({input.record, input.database, columns.get()}, cfg);
+  }
+
+  // Check for integral types that cfg.bitlen fits into the type's bitlength.
+  // A wider type computes the same results as a narrower ring, as the
+  // precisions are chosen to avoid overflows.
   if constexpr (is_integral_v<T>) {
-    if (cfg.bitlen != sizeof(T) * 8) {
+    if (cfg.bitlen > sizeof(T) * 8) {
       print(cerr,
-          "Warning: CircuitConfig's bitlength {} doesn't match the type's {}. "
+          "Warning: CircuitConfig's bitlength {} exceeds the type's {}. "
           "You may want to match them.\n", cfg.bitlen, sizeof(T)*8);
     }
   }
@@ -289,8 +389,10 @@ Result<T> calc(const Input& input, const CircuitConfig& cfg) {
   // for each group, store the best permutation's weight into field_weights
   for (const auto& group : cfg.epi.exchange_groups) {
     // add this group's field weight to vector
+    const bool greedy = cfg.greedy_exchange_group(group.size());
     for (size_t idx = 0; idx != dbsize; ++idx) {
-      scores[idx] += best_group_weight<T>(input, cfg, idx, group);
+      scores[idx] += greedy ? greedy_group_weight<T>(input, cfg, idx, group)
+        : best_group_weight<T>(input, cfg, idx, group);
     }
     // remove all indices that were covered by this index group
     for (const auto& i : group) no_x_group.erase(i);
@@ -320,8 +422,14 @@ Result<T> calc(const Input& input, const CircuitConfig& cfg) {
   const auto& best_score = *best_score_it;
 
   // 3. Test thresholds
-  const bool match = test_threshold(best_score, cfg.epi.threshold, cfg.dice_prec);
-  const bool tmatch = test_threshold(best_score, cfg.epi.tthreshold, cfg.dice_prec);
+  const bool div_free = division_free<T>(cfg);
+  const bool match = test_threshold(best_score, cfg.epi.threshold, cfg.dice_prec, div_free);
+  const bool tmatch = test_threshold(best_score, cfg.epi.tthreshold, cfg.dice_prec, div_free);
+
+  // In division-free mode, the sums are already on the same scale
+  if (div_free) {
+    return {best_idx, match, tmatch, best_score.fw, best_score.w};
+  }
 
   // Need to apply dice precision shift to sum(weights) to bring to same scale
   // as sum(field-weights). This was implicitly done in the threshold test
@@ -346,8 +454,10 @@ Result<double> calc_exact(const Input& input, const CircuitConfig& cfg) {
 // vectorized records
 template<typename T> std::vector<Result<T>> calc(const Records& records,
     const VRecord& database, const CircuitConfig& cfg) {
-  return transform_vec(records, [&database, &cfg](const auto& record) {
-      return calc<T>({record, database}, cfg);
+  // hamming weights of the database only need to be computed once
+  const auto columns = make_field_columns(database, cfg.epi.fields);
+  return transform_vec(records, [&database, &columns, &cfg](const auto& record) {
+      return calc<T>({record, database, columns.get()}, cfg);
       });
 }
 
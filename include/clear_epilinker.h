@@ -31,9 +31,11 @@ namespace sel::clear_epilink {
 struct Input {
   const Record& record;
   const VRecord& database;
+  // columns of database, built by calc() from database if not given
+  const FieldColumns* columns;
   const size_t dbsize;
   Input(const Record& record,
-      const VRecord& database);
+      const VRecord& database, const FieldColumns* columns = nullptr);
 };
 
 /**
@@ -50,6 +52,9 @@ struct Input {
  * T = uint{8,16,32,64}_t to compare circuits of different arithmetic precision
  * Don't forget to then also set bitlen to that type's bitlength when creating
  * the EpilinkConfig, and possibly adjust precisions with set_precisions().
+ * If division-free dice is enabled in the CircuitConfig, the integer variants
+ * calculate the scores the same way as the division-free circuit. Then the
+ * resulting sums aren't scaled by the dice precision.
  */
 Result<CircUnit> calc_integer(const Input& input, const CircuitConfig& cfg);
 Result<double> calc_exact(const Input& input, const CircuitConfig& cfg);
@@ -83,11 +83,22 @@ ServerConfig ConfigurationHandler::get_server_config() const {
 CircuitConfig make_circuit_config(const shared_ptr<const LocalConfiguration>& local_config,
                                   const shared_ptr<const RemoteConfiguration>& remote_config){
 auto server_config{ConfigurationHandler::cget().get_server_config()};
-return {local_config->get_epilink_config(),
+CircuitConfig circuit_config{local_config->get_epilink_config(),
   server_config.circuit_directory,
   remote_config->get_matching_mode(),
   server_config.boolean_sharing,
   server_config.use_circuit_conversion};
+circuit_config.auto_sharing = server_config.auto_sharing;
+circuit_config.batch_records = server_config.batch_records;
+if (server_config.division_free_dice) circuit_config.set_division_free_dice();
+circuit_config.database_chunk_size = server_config.database_chunk_size;
+circuit_config.greedy_exchange_group_size = server_config.greedy_exchange_group_size;
+circuit_config.set_arith_hammingweight(server_config.arith_hammingweight);
+// Precisions are only fitted if given, but then both need to be given
+if (server_config.dice_precision || server_config.weight_precision) {
+  circuit_config.fit_bitlen(server_config.dice_precision, server_config.weight_precision);
+}
+return circuit_config;
 }
 
 nlohmann::json ConfigurationHandler::make_comparison_config(const RemoteId& remote_id) const {
@@ -105,6 +116,21 @@ nlohmann::json ConfigurationHandler::make_comparison_config(const RemoteId& remo
   lock_guard<shared_mutex> remote_lock(m_remote_mutex);
   server_config["matchingMode"] = m_remote_configs.at(remote_id)->get_matching_mode();
   }
+  // Settings that change the shape of the circuit both parties build
+  server_config["batchRecords"] = m_server_config.batch_records;
+  server_config["divisionFreeDice"] = m_server_config.division_free_dice;
+  server_config["databaseChunkSize"] = m_server_config.database_chunk_size;
+  server_config["greedyExchangeGroupSize"] = m_server_config.greedy_exchange_group_size;
+  server_config["arithHammingweight"] = m_server_config.arith_hammingweight;
+  server_config["useCircuitConversion"] = m_server_config.use_circuit_conversion;
+  server_config["booleanSharing"] = m_server_config.boolean_sharing;
+  server_config["autoSharing"] = m_server_config.auto_sharing;
+  // The fitted bitlen follows from the fields and both precisions
+  server_config["dicePrecision"] = m_server_config.dice_precision;
+  server_config["weightPrecision"] = m_server_config.weight_precision;
+  // Both parties decide on their own whether to precompute the setup phase
+  // while idle, which only agrees for equal budgets
+  server_config["idlePrecomputationMiB"] = m_server_config.idle_precomputation_budget >> 20;
   return server_config;
 }
 bool ConfigurationHandler::compare_configuration(const nlohmann::json& client_config, const RemoteId& remote_id) const{
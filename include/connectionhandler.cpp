@@ -91,6 +91,19 @@ Port ConnectionHandler::choose_aby_port() {
   }
 }
 
+vector<Port> ConnectionHandler::choose_aby_ports(size_t n) {
+  lock_guard<mutex> lock(m_port_mutex);
+  if (m_aby_available_ports.size() < n) {
+    throw runtime_error("Not enough available ports for smpc communication");
+  }
+  vector<Port> ports;
+  ports.reserve(n);
+  for (size_t i = 0; i != n; ++i) {
+    ports.emplace_back(m_aby_available_ports.extract(m_aby_available_ports.begin()).value());
+  }
+  return ports;
+}
+
 void ConnectionHandler::mark_port_used(Port port) {
   if (auto it = m_aby_available_ports.find(port);
       it != m_aby_available_ports.end()) {
@@ -72,6 +72,10 @@ class ConnectionHandler {
   Port use_free_port();
   std::set<Port> get_free_ports() const;
   Port choose_aby_port();
+  /**
+   * Takes n ports from the available ports at once
+   */
+  std::vector<Port> choose_aby_ports(size_t n);
   void mark_port_used(Port);
 
   Port initialize_aby_server(std::shared_ptr<RemoteConfiguration>);
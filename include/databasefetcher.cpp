@@ -122,10 +122,13 @@ ServerData DatabaseFetcher::fetch_data(bool matching_mode) {
   m_logger->trace("Recieved Inputs:\n{}", input_string);
 #endif
 
+  // The record-wise pages are only needed until the columns are built
+  auto columns = make_field_columns(m_records, m_local_config->get_fields());
+  m_records.clear();
   if(matching_mode) {
-    return {make_shared<VRecord>(move(m_records)), {}, m_todate, move(m_local_id), move(m_remote_id)};
+    return {move(columns), {}, m_todate, move(m_local_id), move(m_remote_id)};
   } else {
-    return {make_shared<VRecord>(move(m_records)), make_shared<vector<string>>(move(m_ids)), m_todate, move(m_local_id), move(m_remote_id)};
+    return {move(columns), make_shared<vector<string>>(move(m_ids)), m_todate, move(m_local_id), move(m_remote_id)};
   }
 }
 
@@ -40,6 +40,24 @@ void Debugger::reset() {
     return cref(get());
   }
 
+/**
+ * FNV-1a hash over all field names, validity bitmaps and values of the
+ * database. Empty entries are hashed differently from entries of all zeros.
+ */
+static uint64_t database_version(const FieldColumns& columns) {
+  uint64_t hash{0xcbf29ce484222325};
+  const auto update = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 0x100000001b3;
+  };
+  for (const auto& [fname, column] : columns) {
+    for (const auto c : fname) update(c);
+    for (const auto byte : column.validity) update(byte);
+    for (const auto byte : column.values) update(byte);
+  }
+  return hash;
+}
+
 size_t DataHandler::poll_database(const RemoteId& remote_id, bool counting_mode) {
   const auto& config_handler{ConfigurationHandler::cget()};
   const auto local_configuration{config_handler.get_local_config()};
@@ -49,9 +67,10 @@ size_t DataHandler::poll_database(const RemoteId& remote_id, bool counting_mode)
       local_configuration->get_local_authenticator(),
       config_handler.get_server_config().default_page_size};
   auto data{database_fetcher.fetch_data(counting_mode)};
+  data.version = database_version(*data.columns);
   lock_guard<mutex> lock(m_db_mutex);
   m_database = make_shared<const ServerData>(move(data));
-  return (m_database->data->begin()->second.size());
+  return m_database->size();
 }
 
 size_t DataHandler:: poll_database_diff() {
@@ -40,11 +40,16 @@ class ConfigurationHandler;
 class DatabaseFetcher;
 
 struct ServerData {
-  std::shared_ptr<VRecord> data;
+  // Columnar database, built once on ingestion
+  std::shared_ptr<const FieldColumns> columns;
   std::shared_ptr<std::vector<std::string>> ids;
   ToDate todate;
   RemoteId local_id;
   RemoteId remote_id;
+  // Content hash of columns, identifies secret-shared databases across jobs
+  uint64_t version{0};
+
+  size_t size() const { return columns->cbegin()->second.size(); }
 };
 
 #ifdef DEBUG_SEL_REST
@@ -17,6 +17,7 @@
 */
 
 #include <memory>
+#include <cassert>
 #include <algorithm>
 #include <fmt/format.h>
 #include <iostream>
@@ -108,18 +109,100 @@ void EpilinkClientInput::check_keys() {
   }
 }
 
+FieldColumn::FieldColumn(const VFieldEntry& entries, const FieldSpec& spec) :
+  bytesize{bitbytes(spec.bitsize)},
+  nrecords{entries.size()},
+  values(nrecords * bytesize),
+  validity(bitbytes(nrecords))
+{
+  const bool is_bm = spec.comparator == FieldComparator::DICE;
+  if (is_bm) hws.resize(nrecords);
+  for (size_t j = 0; j != nrecords; ++j) {
+    if (!entries[j]) continue;
+    const Bitmask& value = *entries[j];
+    check_vector_size(value, bytesize, "database byte vector "s + spec.name);
+    copy(value.cbegin(), value.cend(), values.begin() + j*bytesize);
+    validity[j/8] |= 1 << (j%8);
+    if (is_bm) hws[j] = hw(value);
+  }
+}
+
+FieldColumn::FieldColumn(const FieldColumn& other, size_t offset, size_t size) :
+  bytesize{other.bytesize},
+  nrecords{size},
+  values(other.value(offset), other.value(offset + size)),
+  validity(bitbytes(size))
+{
+  assert (offset + size <= other.size());
+  for (size_t j = 0; j != size; ++j) {
+    if (other.has_value(offset + j)) validity[j/8] |= 1 << (j%8);
+  }
+  if (!other.hws.empty()) {
+    const auto first = other.hws.cbegin() + offset;
+    hws.assign(first, first + size);
+  }
+}
+
+FieldEntry FieldColumn::entry(size_t idx) const {
+  if (!has_value(idx)) return nullopt;
+  return Bitmask(value(idx), value(idx + 1));
+}
+
+shared_ptr<const FieldColumns> make_field_columns(const VRecord& database,
+    const map<FieldName, FieldSpec>& fields) {
+  auto columns = make_shared<FieldColumns>();
+  for (const auto& [name, entries] : database) {
+    if (const auto spec = fields.find(name); spec != fields.cend()) {
+      columns->emplace(name, FieldColumn{entries, spec->second});
+    }
+  }
+  return columns;
+}
+
+VRecord to_vrecord(const FieldColumns& columns) {
+  VRecord database;
+  for (const auto& [name, column] : columns) {
+    VFieldEntry entries;
+    entries.reserve(column.size());
+    for (size_t j = 0; j != column.size(); ++j) {
+      entries.emplace_back(column.entry(j));
+    }
+    database.emplace(name, move(entries));
+  }
+  return database;
+}
+
 void EpilinkServerInput::check_sizes() {
-  for (const auto& row : *database) {
-    check_vector_size(row.second, database_size, "database field "s + row.first);
+  if (database) {
+    for (const auto& row : *database) {
+      check_vector_size(row.second, database_size, "database field "s + row.first);
+    }
+  }
+  if (columns) {
+    for (const auto& [name, column] : *columns) {
+      if (column.size() != database_size) {
+        throw invalid_argument{format("Precomputed column of field {} has size "
+            "{} but database has size {}", name, column.size(), database_size)};
+      }
+    }
   }
 }
 
-EpilinkServerInput::EpilinkServerInput(shared_ptr<VRecord> database_, size_t num_records_) :
+EpilinkServerInput::EpilinkServerInput(shared_ptr<VRecord> database_,
+    size_t num_records_, shared_ptr<const FieldColumns> columns_) :
   database(move(database_)),
+  columns(move(columns_)),
   database_size {database->cbegin()->second.size()},
   num_records {num_records_}
 { check_sizes(); }
 
+EpilinkServerInput::EpilinkServerInput(shared_ptr<const FieldColumns> columns_,
+    size_t num_records_) :
+  columns(move(columns_)),
+  database_size {columns->cbegin()->second.size()},
+  num_records {num_records_}
+{ check_sizes(); }
+
 EpilinkServerInput::EpilinkServerInput(const VRecord& database_, size_t num_records_) :
   database(make_shared<VRecord>(database_)),
   database_size {database->cbegin()->second.size()},
@@ -155,7 +238,8 @@ std::ostream& operator<<(std::ostream& os, const sel::EpilinkClientInput& in) {
 
 std::ostream& operator<<(std::ostream& os, const sel::EpilinkServerInput& in) {
   os << "----- Server Input -----\n";
-  for (const auto& fs : *(in.database)) {
+  const auto database = in.database ? *in.database : sel::to_vrecord(*in.columns);
+  for (const auto& fs : database) {
     for (size_t i = 0; i != fs.second.size(); ++i) {
       os << fs.first << '[' << i << "]: " << fs.second[i] << '\n';
     }
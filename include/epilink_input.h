@@ -87,16 +87,64 @@ private:
   void check_keys(); // called by public constructors to check that keys match
 };
 
+/**
+ * Columnar storage of a database field, built once per database snapshot.
+ * Holds all values bit-packed back-to-back with a fixed stride of bytesize
+ * bytes per record, empty entries zeroed, a validity bitmap of which records
+ * have a value, and for bitmask fields their hammingweights.
+ * In contrast to a VFieldEntry, the whole column lives in a few contiguous
+ * buffers, so that it can be input to circuits and compared without copies.
+ * The values buffer is deliberately not aligned beyond the allocator's
+ * default: ABY's SIMD input gates read the values at the packed stride, so
+ * records can't be padded to aligned offsets anyway, and the bitmask kernels
+ * like bm_and_hw() only use unaligned loads.
+ */
+struct FieldColumn {
+  size_t bytesize;
+  size_t nrecords;
+  Bitmask values;
+  Bitmask validity; // bit idx%8 of byte idx/8 is set iff record idx has a value
+  std::vector<size_t> hws; // empty for non-bitmask fields
+
+  FieldColumn(const VFieldEntry& entries, const FieldSpec& spec);
+  // Slice of records [offset, offset+size) of other column
+  FieldColumn(const FieldColumn& other, size_t offset, size_t size);
+
+  size_t size() const { return nrecords; }
+  bool has_value(size_t idx) const { return (validity[idx/8] >> (idx%8)) & 1; }
+  const BitmaskUnit* value(size_t idx) const { return values.data() + idx*bytesize; }
+  // Materialized copy of entry idx
+  FieldEntry entry(size_t idx) const;
+};
+using FieldColumns = std::map<FieldName, FieldColumn>;
+
+/**
+ * Builds the columns of all fields of the database which are specified in
+ * fields.
+ */
+std::shared_ptr<const FieldColumns> make_field_columns(const VRecord& database,
+    const std::map<FieldName, FieldSpec>& fields);
+
+/**
+ * Converts columns back to the record-wise layout
+ */
+VRecord to_vrecord(const FieldColumns& columns);
+
 struct EpilinkServerInput {
   // Outer vector by fields, inner by records!
   // Need to model like this for ABY SIMD layout
+  // May be null if the database is only given as columns.
   std::shared_ptr<VRecord> database;
+  // Columns of database, computed on the fly from database if missing
+  std::shared_ptr<const FieldColumns> columns;
 
   size_t database_size; // calculated
   // need to know number of remote client records when building circuit
   size_t num_records;
 
-  EpilinkServerInput(std::shared_ptr<VRecord> database, size_t num_records);
+  EpilinkServerInput(std::shared_ptr<VRecord> database, size_t num_records,
+      std::shared_ptr<const FieldColumns> columns = nullptr);
+  EpilinkServerInput(std::shared_ptr<const FieldColumns> columns, size_t num_records);
   EpilinkServerInput(const VRecord& database, size_t num_records);
   EpilinkServerInput(const EpilinkServerInput&) = default;
   EpilinkServerInput(EpilinkServerInput&&) = default;
@@ -18,6 +18,7 @@ later version. This program is distributed in the hope that it will be useful,
 #include <string>
 #include <map>
 #include <thread>
+#include <optional>
 #include "resttypes.h"
 #include "restbed"
 #include "restresponses.hpp"
@@ -27,6 +28,9 @@ later version. This program is distributed in the hope that it will be useful,
 #include "connectionhandler.h"
 #include "logger.h"
 #include "util.h"
+#include "datahandler.h"
+#include "localserver.h"
+#include "secure_epilinker.h"
 
 using namespace std;
 namespace sel{
@@ -54,18 +58,45 @@ SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
   if(header.find("Counting-Mode") == header.end()) {
     counting_mode = false;
   }
-  aby_server_port = ServerHandler::cget().get_server_port(remote_id);
-  size_t num_records = stoull(header.find("Record-Number")->second);
+  // MPC lane of the job, clients without lanes only use the first one
+  size_t lane{0};
+  size_t num_records;
+  // Version of the secret-shared database the client saved, if any
+  optional<uint64_t> client_db_version;
+  try {
+    if(auto l = header.find("SEL-Lane"); l != header.end()) {
+      lane = stoull(l->second);
+    }
+    num_records = stoull(header.find("Record-Number")->second);
+    if(auto v = header.find("Shared-Database-Version"); v != header.end()) {
+      client_db_version = stoull(v->second, nullptr, 16);
+    }
+  } catch (const exception& e) {
+    logger->error("Malformed MPC header from {}: {}", remote_id, e.what());
+    return responses::status_error(400, "Malformed MPC header");
+  }
+  if(lane >= ServerHandler::cget().get_num_server_lanes(remote_id)) {
+    logger->error("Invalid MPC lane {} from {}", lane, remote_id);
+    return responses::status_error(400, "Invalid MPC lane");
+  }
+  aby_server_port = ServerHandler::cget().get_server_port(remote_id, lane);
   counting_mode = header.find("Counting-Mode")->second == "true" ? true : false;
   size_t server_record_number;
   shared_ptr<const ServerData> data;
   try {
-    server_record_number = DataHandler::get().poll_database(remote_id, counting_mode);
+    DataHandler::get().poll_database(remote_id, counting_mode);
     data = DataHandler::get().get_database();
+    // Concurrent polls of other lanes may replace the database in between,
+    // so take the size of the data we actually use
+    server_record_number = data->size();
   } catch (const exception& e){
     logger->error("Error geting data from dataservice: {}", e.what());
     return sel::responses::status_error(restbed::INTERNAL_SERVER_ERROR, "Can not get data from dataservice");
   }
+  const auto server_db_version{ServerHandler::cget().get_local_server(remote_id, lane)
+    ->get_epilinker().get_saved_database_version()};
+  const bool reuse_shares{client_db_version && server_db_version
+    && *client_db_version == data->version && *server_db_version == data->version};
   response.return_code = restbed::OK;
   if(!counting_mode){
     response.body = "Linkage server running"s;
@@ -75,11 +106,13 @@ SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
   response.headers = {{"Content-Length", to_string(response.body.length())},
                       {"Record-Number", to_string(server_record_number)},
                       {"SEL-Port", to_string(aby_server_port)},
+                      {"Database-Version", fmt::format("{:x}", data->version)},
+                      {"Reuse-Shared-Database", reuse_shares ? "true" : "false"},
                       {"Connection", "Close"}};
-  std::thread server_runner([remote_id, data, num_records, counting_mode]() {
-      ServerHandler::get().run_server(remote_id, data, num_records, counting_mode);
-  });
-  server_runner.detach();
+  // Queue before responding, so that the server runs in the order of the
+  // client's jobs, even if the client already prepares its next job.
+  ServerHandler::get().queue_server_run(remote_id, lane, data, num_records,
+      counting_mode, reuse_shares);
   return response;
 }
 
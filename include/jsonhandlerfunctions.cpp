@@ -61,20 +61,20 @@ SessionResponse valid_test_config_json_handler(
         auth_result.return_code != 200){ // auth not ok
       return auth_result;
     }
-    Port aby_port = connection_handler.choose_aby_port();
-    logger->debug("ABY Server port: {}", aby_port);
+    const size_t num_lanes{max<size_t>(1, config_handler.get_server_config().aby_lanes)};
+    auto aby_ports = connection_handler.choose_aby_ports(num_lanes);
+    logger->debug("ABY Server ports: {}", aby_ports);
     auto client_comparison_config = client_config;
     // Compare Configs
     if (config_handler.compare_configuration(client_comparison_config, remote_id)) {
       logger->info("Valid config");
-      remote_config->set_aby_port(aby_port);
+      remote_config->set_aby_ports(aby_ports);
       remote_config->mark_mutually_initialized();
 
-      logger->info("Building MPC Server");
-      RemoteAddress tempadr{remote_config->get_remote_host(),aby_port};
-      std::thread server_creator([remote_id,tempadr](){ServerHandler::get().insert_server(remote_id, tempadr);});
+      logger->info("Building MPC Server with {} lanes", num_lanes);
+      std::thread server_creator([remote_id,aby_ports](){ServerHandler::get().insert_server(remote_id, aby_ports);});
       server_creator.detach();
-      return responses::server_initialized(aby_port);
+      return responses::server_initialized(aby_ports);
     } else {
       logger->error("Invalid Configs");
       return responses::status_error(restbed::BAD_REQUEST,"Configurations are not compatible");
@@ -72,18 +72,34 @@ RemoteId LinkageJob::get_remote_id() const {
   return m_remote_config->get_id();
 }
 
+void LinkageJob::prepare() {
+  auto logger{get_logger(ComponentLogger::CLIENT)};
+  try {
+    // Get number of records from server
+    size_t num_records{m_records->size()};
+    // Wait for a reply with timeout. The request is kept as member, so that
+    // destroying its future does not block on a timed out request here.
+    m_server_info_request = std::async(std::launch::async,
+        &LinkageJob::get_server_database_info, this, num_records);
+    if(m_server_info_request.wait_for(15s) == future_status::timeout){
+      throw runtime_error("Timeout retrieving number of records from server");
+    }
+    m_server_info = m_server_info_request.get();
+  } catch (const exception& e) {
+    logger->error("Error preparing MPC Client: {}\n", e.what());
+    m_status = JobStatus::FAULT;
+  }
+}
+
 LinkageJob::JobPreparation LinkageJob::prepare_run() {
-  m_status = JobStatus::RUNNING;
-  // Get number of records from server
-  size_t num_records{m_records->size()};
-  //this future trickery has to be done to properly wait for a reply
-  auto nvals{std::async(&LinkageJob::get_server_nvals, this, num_records)};
-  nvals.wait_for(15s);
-  if(!nvals.valid()){
-    throw runtime_error("Error retrieving number of records from server");
+  if (!m_server_info) {
+    throw runtime_error("Job needs to be prepared before running");
   }
-  const auto database_size{nvals.get()};
-  return {num_records, database_size, ServerHandler::get().get_epilink_client(m_remote_config->get_id())};
+  m_status = JobStatus::RUNNING;
+  const auto [database_size, version, reuse_shares]{*m_server_info};
+  auto epilinker{ServerHandler::get().get_epilink_client(m_remote_config->get_id(), m_lane)};
+  epilinker->set_database_version(version, reuse_shares);
+  return {m_records->size(), database_size, move(epilinker)};
 }
 
 
@@ -101,22 +117,14 @@ void LinkageJob::run_linkage_job() {
       auto input_copy{*m_records};
 #endif
     epilinker->set_client_input({move(m_records), database_size});
-    auto linkage_share{epilinker->run_linkage()};
+    m_linkage_result = epilinker->run_linkage();
       // reset epilinker for the next linkage
       epilinker->reset();
-      logger->info("Client Result: {}", linkage_share);
+      logger->info("Client Result: {}", m_linkage_result);
 #ifdef DEBUG_SEL_REST
       compute_debugging_result(input_copy);
 #endif
-      try{
-        auto response{send_result_to_linkageservice(linkage_share, nullopt , "client", m_local_config, m_remote_config)};
-        if (response.return_code == 200) {
-          perform_callback(response.body);
-        }
-      } catch (const exception& e) {
-        get_logger(ComponentLogger::REST)->error("Can not connect to linkage service or callback: {}", e.what());
-      }
-    m_status = JobStatus::DONE;
+    epilinker->run_idle_setup_phase();
   } catch (const exception& e) {
     logger->error("Error running MPC Client: {}\n", e.what());
     m_status = JobStatus::FAULT;
@@ -137,19 +145,10 @@ void LinkageJob::run_matching_job() {
       print_data();
 #endif
     epilinker->set_input({move(m_records), database_size});
-    auto count_result{epilinker->run_count()};
+    m_count_result = epilinker->run_count();
       // reset epilinker for the next operation
       epilinker->reset();
-      // The strange assembly of the json is due to strange object/array
-      // distinctions in nlohmann/json
-      nlohmann::json match_json;
-      nlohmann::json match_result;
-      match_result["matches"] = count_result.matches;
-      match_result["tentativeMatches"] = count_result.tmatches;
-      match_json["result"] = match_result;
-      logger->trace("Result to callback: {}", match_json.dump(0));
-      perform_callback(match_json.dump());
-    m_status = JobStatus::DONE;
+    epilinker->run_idle_setup_phase();
   } catch (const exception& e) {
     logger->error("Error running MPC Client: {}\n", e.what());
     m_status = JobStatus::FAULT;
@@ -161,6 +160,40 @@ void LinkageJob::run_matching_job() {
 #endif
 }
 
+void LinkageJob::finish() {
+  if (m_counting_job) send_count_result();
+  else send_linkage_result();
+  m_status = JobStatus::DONE;
+}
+
+void LinkageJob::send_linkage_result() {
+  try{
+    auto response{send_result_to_linkageservice(m_linkage_result, nullopt , "client", m_local_config, m_remote_config)};
+    if (response.return_code == 200) {
+      perform_callback(response.body);
+    }
+  } catch (const exception& e) {
+    get_logger(ComponentLogger::REST)->error("Can not connect to linkage service or callback: {}", e.what());
+  }
+}
+
+void LinkageJob::send_count_result() {
+  auto logger{get_logger(ComponentLogger::CLIENT)};
+  // The strange assembly of the json is due to strange object/array
+  // distinctions in nlohmann/json
+  nlohmann::json match_json;
+  nlohmann::json match_result;
+  match_result["matches"] = m_count_result->matches;
+  match_result["tentativeMatches"] = m_count_result->tmatches;
+  match_json["result"] = match_result;
+  logger->trace("Result to callback: {}", match_json.dump(0));
+  try{
+    perform_callback(match_json.dump());
+  } catch (const exception& e) {
+    get_logger(ComponentLogger::REST)->error("Can not connect to callback: {}", e.what());
+  }
+}
+
 void LinkageJob::set_local_config(shared_ptr<LocalConfiguration> l_config) {
   m_local_config = move(l_config);
 }
@@ -169,7 +202,7 @@ void LinkageJob::set_local_config(shared_ptr<LocalConfiguration> l_config) {
  * Send server the configuration to compare and recieve back the number of
  * records in the database
  */
-size_t LinkageJob::get_server_nvals(size_t num_records) {
+LinkageJob::ServerDatabaseInfo LinkageJob::get_server_database_info(size_t num_records) {
   auto logger{get_logger(ComponentLogger::CLIENT)};
   //FIXME(TK): THIS IS BAD AND I SHOULD FEEL BAD
   std::this_thread::sleep_for(500ms);
@@ -177,22 +210,37 @@ size_t LinkageJob::get_server_nvals(size_t num_records) {
       "Authorization: "s+m_remote_config->get_remote_authenticator().sign_transaction(""),
       "Record-Number: "s + to_string(num_records),
       "Counting-Mode: "s + (m_counting_job ? "true" : "false"),
+      "SEL-Lane: "s + to_string(m_lane),
       "Content-Type: application/json"};
+  auto epilinker{ServerHandler::get().get_epilink_client(m_remote_config->get_id(), m_lane)};
+  if(const auto saved_version = epilinker->get_saved_database_version()) {
+    headers.emplace_back(fmt::format("Shared-Database-Version: {:x}", *saved_version));
+  }
   string url{assemble_remote_url(m_remote_config) + "/initMPC/"+m_local_config->get_local_id()};
   logger->debug("Sending {} request to {}\n",(m_counting_job ? "matching" : "linkage"), url);
   try{
     // TODO(TK): Refactor perform_post_request w/ optional to avoid dummy data
     auto response{perform_post_request(url, "{}", headers, true)};
     logger->debug("Response stream:\n{} - {}\n",response.return_code, response.body);
-    // get nvals from response header
+    // get nvals and database version from response header
     if (response.return_code == 200) {
-      return stoull(get_headers(response.body, "Record-Number").front());
+      ServerDatabaseInfo info{
+        stoull(get_headers(response.body, "Record-Number").front()), 0, false};
+      // Servers not supporting shared databases omit these headers
+      if(auto v = get_headers(response.body, "Database-Version"); !v.empty()) {
+        info.version = stoull(v.front(), nullptr, 16);
+      }
+      if(auto r = get_headers(response.body, "Reuse-Shared-Database"); !r.empty()) {
+        info.reuse_shares = r.front() == "true";
+      }
+      return info;
     } else {
       logger->error("Error communicating with remote epilinker: {} - {}", response.return_code, response.body);
     }
   } catch (const exception& e) {
     logger->error("Error performing initMPC call: {}", e.what());
   }
+  throw runtime_error("Error retrieving database information from server");
 }
 
 bool LinkageJob::perform_callback(const string& body) const {
@@ -30,7 +30,11 @@
 #include <variant>
 #include <vector>
 #include <map>
+#include <optional>
+#include <future>
 #include "epilink_input.h"
+#include "epilink_result.hpp"
+#include "circuit_config.h" // CircUnit
 
 namespace restbed {
 class Service;
@@ -44,6 +48,11 @@ class ServerHandler;
 class SecureEpilinker;
 
 class LinkageJob {
+  struct ServerDatabaseInfo {
+    size_t database_size;
+    uint64_t version;
+    bool reuse_shares;
+  };
   struct JobPreparation {
     size_t num_records;
     size_t database_size;
@@ -60,12 +69,26 @@ class LinkageJob {
    void set_counting_job() {m_counting_job = true;}
    JobId get_id() const;
    RemoteId get_remote_id() const;
+   /**
+    * MPC lane of the remote to run this job on
+    */
+   void set_lane(size_t lane) {m_lane = lane;}
+   size_t get_lane() const {return m_lane;}
+   /**
+    * Requests the database information from the remote server, which queues
+    * its part of the job. Can run while the previous job is still running.
+    */
+   void prepare();
    void run_linkage_job();
    void run_matching_job();
+   /**
+    * Sends the results of the run job to the linkage service and callback
+    */
+   void finish();
    void set_local_config(std::shared_ptr<LocalConfiguration>);
  private:
   JobPreparation prepare_run();
-  size_t get_server_nvals(size_t);
+  ServerDatabaseInfo get_server_database_info(size_t);
   bool perform_callback(const std::string&) const;
 #ifdef DEBUG_SEL_REST
   void compute_debugging_result(const Records&);
@@ -78,6 +101,15 @@ class LinkageJob {
   std::shared_ptr<const LocalConfiguration> m_local_config;
   std::shared_ptr<const RemoteConfiguration> m_remote_config;
   bool m_counting_job{false};
+  size_t m_lane{0};
+  std::optional<ServerDatabaseInfo> m_server_info;
+  std::vector<Result<CircUnit>> m_linkage_result;
+  std::optional<CountResult<CircUnit>> m_count_result;
+  // Outstanding database info request of prepare(). Declared last so that it
+  // is destroyed first, waiting for a timed out request that still uses this.
+  std::future<ServerDatabaseInfo> m_server_info_request;
+  void send_linkage_result();
+  void send_count_result();
 };
 
 }  // namespace sel
@@ -42,7 +42,8 @@ LocalServer::LocalServer(RemoteId remote_id,
       m_aby_server(
           {MPCRole::SERVER,
            m_client_ip, m_client_port,
-           ConfigurationHandler::cget().get_server_config().aby_threads},
+           ConfigurationHandler::cget().get_server_config().aby_threads,
+           ConfigurationHandler::cget().get_server_config().idle_precomputation_budget},
           make_circuit_config(ConfigurationHandler::cget().get_local_config(),
             ConfigurationHandler::cget().get_remote_config(remote_id))) {}
 
@@ -58,17 +59,20 @@ RemoteId LocalServer::get_id() const {
   return m_remote_id;
 }
 
-void LocalServer::run_linkage(shared_ptr<const ServerData> data, size_t num_records) {
+void LocalServer::run_linkage(shared_ptr<const ServerData> data,
+    size_t num_records, bool reuse_shares) {
+  lock_guard<mutex> run_lock(m_run_mutex);
   m_data = move(data);
   auto logger{get_logger(ComponentLogger::SERVER)};
   logger->info("The linkage server is running");
-  const size_t database_size{m_data->data->begin()->second.size()};
+  const size_t database_size{m_data->size()};
 #ifdef DEBUG_SEL_REST
-  DataHandler::get().get_epilink_debug()->server_input = *(m_data->data);
+  DataHandler::get().get_epilink_debug()->server_input = to_vrecord(*m_data->columns);
 #endif
+  m_aby_server.set_database_version(m_data->version, reuse_shares);
   m_aby_server.build_linkage_circuit(num_records, database_size);
   m_aby_server.run_setup_phase();
-  m_aby_server.set_server_input({m_data->data, num_records});
+  m_aby_server.set_server_input({m_data->columns, num_records});
   auto linkage_result = m_aby_server.run_linkage();
   m_aby_server.reset();
 
@@ -79,6 +83,7 @@ void LocalServer::run_linkage(shared_ptr<const ServerData> data, size_t num_reco
   }
   logger->debug("IDs:\n{}", id_string);
   send_server_result_to_linkageservice(linkage_result);
+  m_aby_server.run_idle_setup_phase();
 
 }
 
@@ -99,20 +104,24 @@ void LocalServer::send_server_result_to_linkageservice(const vector<Result<CircU
 
 }
 
-void LocalServer::run_count(shared_ptr<const ServerData> data, size_t num_records) {
+void LocalServer::run_count(shared_ptr<const ServerData> data,
+    size_t num_records, bool reuse_shares) {
+  lock_guard<mutex> run_lock(m_run_mutex);
   m_data = move(data);
 
   auto logger{get_logger()};
   logger->info("The server is running and performing its matching computations");
 
-  const size_t database_size{m_data->data->begin()->second.size()};
+  const size_t database_size{m_data->size()};
+  m_aby_server.set_database_version(m_data->version, reuse_shares);
   m_aby_server.build_count_circuit(num_records, database_size);
   m_aby_server.run_setup_phase();
   logger->debug("Starting server matching computation");
-  m_aby_server.set_input({m_data->data, num_records});
+  m_aby_server.set_input({m_data->columns, num_records});
   auto count_result = m_aby_server.run_count();
   m_aby_server.reset();
   logger->debug("Server Result\n{}", count_result);
+  m_aby_server.run_idle_setup_phase();
 }
 
 Port LocalServer::get_port() const {
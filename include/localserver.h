@@ -21,6 +21,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include "secure_epilinker.h"
 #include "seltypes.h"
 #include "resttypes.h"
@@ -42,8 +43,8 @@ class LocalServer {
               SecureEpilinker::ABYConfig,
               CircuitConfig);
   RemoteId get_id() const;
-  void run_linkage(std::shared_ptr<const ServerData>, size_t);
-  void run_count(std::shared_ptr<const ServerData>, size_t);
+  void run_linkage(std::shared_ptr<const ServerData>, size_t, bool);
+  void run_count(std::shared_ptr<const ServerData>, size_t, bool);
   Port get_port() const;
   std::string get_ip() const;
   SecureEpilinker& get_epilinker();
@@ -58,6 +59,8 @@ class LocalServer {
   Port m_client_port;
   std::shared_ptr<const ServerData> m_data;
   SecureEpilinker m_aby_server;
+  // Jobs may arrive while the previous job's idle precomputation is running
+  std::mutex m_run_mutex;
 };
 }  // namespace sel
 
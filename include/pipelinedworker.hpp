@@ -0,0 +1,114 @@
+/**
+ \file    pipelinedworker.hpp
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Worker with a pipeline of serial prepare, run and finish stages
+*/
+
+#ifndef SEL_PIPELINEDWORKER_HPP
+#define SEL_PIPELINEDWORKER_HPP
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "serialworker.hpp"
+
+namespace sel {
+
+/**
+ * A pipelined worker
+ *
+ * Pushed jobs pass three stages in push order: prepare, run and finish. Each
+ * stage has its own serial worker thread, so that the stages of consecutive
+ * jobs overlap: while a job runs, the next one is prepared and the previous
+ * one is finished. A stage returning false drops the job from the pipeline.
+ *
+ * At most max_ahead jobs are prepared ahead of the running job, so that
+ * preparations don't go stale while waiting.
+ */
+template<typename T>
+class PipelinedWorker {
+  using StageConsumer = std::function<bool (const std::shared_ptr<T>&)>;
+
+public:
+  PipelinedWorker(const StageConsumer& prepare, const StageConsumer& run,
+      const StageConsumer& finish, size_t max_ahead = 1) :
+    max_in_flight_{max_ahead + 1},
+    finisher_{[finish](const std::shared_ptr<T>& job) { finish(job); }},
+    runner_{[this, run](const std::shared_ptr<T>& job) {
+      const bool ok = run(job);
+      release_slot();
+      if (ok) finisher_.push(job);
+    }},
+    preparer_{[this, prepare](const std::shared_ptr<T>& job) {
+      acquire_slot();
+      if (prepare(job)) runner_.push(job);
+      else release_slot();
+    }}
+  {}
+
+  void push(std::shared_ptr<T> job) {
+    preparer_.push(std::move(job));
+  }
+
+  void interrupt() {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    interrupted_ = true;
+    mlock.unlock();
+    cond_.notify_all();
+    preparer_.interrupt();
+    runner_.interrupt();
+    finisher_.interrupt();
+  }
+
+  void join() {
+    preparer_.join();
+    runner_.join();
+    finisher_.join();
+  }
+
+  PipelinedWorker()=delete;
+  PipelinedWorker(const PipelinedWorker&) = delete;
+  PipelinedWorker& operator=(const PipelinedWorker&) = delete;
+
+private:
+  // Number of jobs prepared or running
+  const size_t max_in_flight_;
+  size_t in_flight_{0};
+  bool interrupted_{false};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  // Stages in reverse order, as each stage pushes to the next one
+  SerialWorker<T> finisher_;
+  SerialWorker<T> runner_;
+  SerialWorker<T> preparer_;
+
+  void acquire_slot() {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    cond_.wait(mlock, [this]{ return interrupted_ || in_flight_ < max_in_flight_; });
+    ++in_flight_;
+  }
+
+  void release_slot() {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    --in_flight_;
+    mlock.unlock();
+    cond_.notify_one();
+  }
+};
+
+} /* end of namespace: sel */
+#endif /* end of include guard: SEL_PIPELINEDWORKER_HPP */
@@ -63,12 +63,12 @@ RemoteId RemoteConfiguration::get_id() const {
   return m_remote_id;
 }
 
-Port RemoteConfiguration::get_aby_port() const {
-  return m_aby_port;
+const vector<Port>& RemoteConfiguration::get_aby_ports() const {
+  return m_aby_ports;
 }
 
-void RemoteConfiguration::set_aby_port(Port port) {
-  m_aby_port = port;
+void RemoteConfiguration::set_aby_ports(vector<Port> ports) {
+  m_aby_ports = move(ports);
 }
 
 void RemoteConfiguration::set_matching_mode(bool matching_mode) {
@@ -110,8 +110,10 @@ void RemoteConfiguration::test_configuration(
   }
   const auto aby_server_port{get_headers(response.body, "SEL-Port")};
   if (!aby_server_port.empty()) {
-    logger->info("Client registered aby Port {}", aby_server_port.front());
-    set_aby_port(stoul(aby_server_port.front()));
+    logger->info("Client registered aby Ports {}", aby_server_port.front());
+    // One port per MPC lane
+    set_aby_ports(transform_vec(split(aby_server_port.front(), ','),
+          [](const string& port) { return static_cast<Port>(stoul(port)); }));
     mark_mutually_initialized();
     std::thread client_creator([this](){ServerHandler::get().insert_client(m_remote_id);});
     client_creator.detach();
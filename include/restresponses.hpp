@@ -18,11 +18,21 @@
 
 #include "resttypes.h"
 #include "corvusoft/restbed/status_code.hpp"
+#include <string>
+#include <vector>
 
 namespace sel{
   namespace responses{
-  inline SessionResponse server_initialized(Port port){
-    return{restbed::OK, "Connection Initialized", {{"Content-Length", "22"},{"Connection", "Close"}, {"SEL-Port", std::to_string(port)}}};
+  /**
+   * SEL-Port holds the comma-separated ports of all MPC lanes
+   */
+  inline SessionResponse server_initialized(const std::vector<Port>& ports){
+    std::string port_list;
+    for (const auto port : ports) {
+      if (!port_list.empty()) port_list += ',';
+      port_list += std::to_string(port);
+    }
+    return{restbed::OK, "Connection Initialized", {{"Content-Length", "22"},{"Connection", "Close"}, {"SEL-Port", port_list}}};
   }
   inline SessionResponse status_error(int status, std::string msg) {
   return {status, msg, {{"Content-Length", std::to_string(msg.length())},
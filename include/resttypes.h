@@ -64,12 +64,24 @@ struct ServerConfig {
   std::filesystem::path circuit_directory;
   bool use_ssl;
   bool use_circuit_conversion;
+  bool batch_records;
+  bool division_free_dice;
+  size_t database_chunk_size;
+  size_t greedy_exchange_group_size;
+  // Precisions to fit the arithmetic ring bitlen to, 0 for the ideal
+  // precisions of the full bitlen
+  size_t dice_precision;
+  size_t weight_precision;
+  bool arith_hammingweight;
   Port server_port;
   std::string bind_address;
   size_t rest_worker;
   size_t default_page_size;
   uint32_t aby_threads;
+  size_t aby_lanes;
+  size_t idle_precomputation_budget; // in bytes
   BooleanSharing boolean_sharing;
+  bool auto_sharing; // choose sharing and conversion per circuit shape
   std::set<Port> avaliable_aby_ports;
 };
 
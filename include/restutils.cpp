@@ -80,6 +80,8 @@ ServerConfig parse_json_server_config(const nlohmann::json& json) {
   // config file
   transform(sharing_type.begin(), sharing_type.end(), sharing_type.begin(), ::toupper);
   boolean_sharing = (sharing_type == "YAO") ? BooleanSharing::YAO : BooleanSharing::GMW;
+  // "auto" chooses the sharing and conversion per circuit shape
+  const bool auto_sharing = (sharing_type == "AUTO");
   auto aby_ports{get_checked_result<set<Port>>(json,"abyPorts")};
   ServerConfig result{get_checked_result<string>(json,"localInitSchemaPath"),
           get_checked_result<string>(json,"remoteInitSchemaPath"),
@@ -91,12 +93,22 @@ ServerConfig parse_json_server_config(const nlohmann::json& json) {
           get_checked_result<string>(json,"circuitDirectory"),
           get_checked_result<bool>(json,"useSSL"),
           get_checked_result<bool>(json,"useCircuitConversion"),
+          get_checked_result<bool>(json,"batchRecords"),
+          get_checked_result<bool>(json,"divisionFreeDice"),
+          get_checked_result<size_t>(json,"databaseChunkSize"),
+          get_checked_result<size_t>(json,"greedyExchangeGroupSize"),
+          get_checked_result<size_t>(json,"dicePrecision"),
+          get_checked_result<size_t>(json,"weightPrecision"),
+          get_checked_result<bool>(json,"arithHammingweight"),
           get_checked_result<Port>(json,"port"),
           get_checked_result<string>(json,"bindAddress"),
           get_checked_result<size_t>(json,"restWorkerThreads"),
           get_checked_result<size_t>(json,"defaultPageSize"),
           get_checked_result<uint32_t>(json,"abyThreads"),
+          get_checked_result<size_t>(json,"abyLanes"),
+          get_checked_result<size_t>(json,"idlePrecomputationMiB") << 20,
           boolean_sharing,
+          auto_sharing,
           aby_ports};
   test_server_config_paths(result);
   return result;
@@ -17,12 +17,17 @@
 */
 
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "fmt/format.h"
 using fmt::format;
 #include "abycore/aby/abyparty.h"
 #include "abycore/sharing/sharing.h"
 #include "secure_epilinker.h"
 #include "circuit_builder.h"
+#include "aby/Share.h"
+#include "aby/gadgets.h"
 #include "util.h"
 #include "seltypes.h"
 #include "logger.h"
@@ -44,18 +49,28 @@ e_role to_aby_role(MPCRole r) {
   return r == MPCRole::CLIENT ? CLIENT : SERVER;
 }
 
+/**
+ * Bitlength of the arithmetic ring of the ABYParty, checking that it is
+ * supported. See CircuitConfig::fit_bitlen().
+ */
+uint32_t ring_bitlen(const CircuitConfig& cfg) {
+  if (find(RingBitLens.cbegin(), RingBitLens.cend(), cfg.bitlen) == RingBitLens.cend()) {
+    throw invalid_argument(fmt::format(
+          "Unsupported bitlen {} of the arithmetic ring!", cfg.bitlen));
+  }
+  return cfg.bitlen;
+}
+
 SecureEpilinker::SecureEpilinker(ABYConfig config, CircuitConfig circuit_config) :
-  party{make_unique<ABYParty>(to_aby_role(config.role), config.host, config.port, LT, BitLen, config.nthreads)},
-  bcirc{dynamic_cast<BooleanCircuit*>(party->GetSharings()[to_aby_sharing(circuit_config.bool_sharing)]
-      ->GetCircuitBuildRoutine())},
-  ccirc{dynamic_cast<BooleanCircuit*>(party->GetSharings()[to_aby_sharing(other(circuit_config.bool_sharing))]
-      ->GetCircuitBuildRoutine())},
+  role{config.role},
+  precomp_budget{config.precomp_budget},
+  party{make_unique<ABYParty>(to_aby_role(config.role), config.host, config.port, LT, ring_bitlen(circuit_config), config.nthreads)},
+  bcirc{bool_circuit(circuit_config.bool_sharing)},
+  ccirc{bool_circuit(other(circuit_config.bool_sharing))},
   acirc{dynamic_cast<ArithmeticCircuit*>(party->GetSharings()[S_ARITH]->GetCircuitBuildRoutine())},
   cfg{circuit_config}, selc{make_unique_circuit_builder(cfg, bcirc, ccirc, acirc)} {
     get_logger()->debug("SecureEpilinker created.");
   }
-// TODO when ABY can separate circuit building/setup/online phases, we create
-// different SELCircuits per build_circuit()...
 
 // Need to _declare_ in header but _define_ here because we use a unique_ptr
 // pimpl.
@@ -67,6 +82,162 @@ void SecureEpilinker::connect() {
   // Currently, we only let the aby parties connect, which runs the Base OTs.
   party->ConnectAndBaseOTs();
   logger->trace("ABYParty connected.");
+
+  if (cfg.auto_sharing) {
+    network = probe_network();
+    logger->info("Network probed for automatic sharing choice: "
+        "RTT {:.3f} ms, bandwidth {:.3f} MiB/s",
+        network->rtt * 1e3, network->bandwidth / (1 << 20));
+  }
+}
+
+BooleanCircuit* SecureEpilinker::bool_circuit(BooleanSharing bool_sharing) const {
+  return dynamic_cast<BooleanCircuit*>(
+      party->GetSharings()[to_aby_sharing(bool_sharing)]->GetCircuitBuildRoutine());
+}
+
+// Number of sequential AND gates to measure the round-trip time
+constexpr uint32_t ProbeDepth = 32;
+// Number of parallel AND gates to measure the bandwidth
+constexpr uint32_t ProbeNumANDs = 1 << 20;
+// Database size of the smaller reference circuit to predict runtimes from
+constexpr size_t ReferenceDatabaseSize = 4;
+
+aby::NetworkProfile SecureEpilinker::probe_network() {
+  const auto& logger = get_logger();
+  logger->trace("Probing network...");
+  BooleanCircuit* gmw = bool_circuit(GMW);
+  const e_role me = to_aby_role(role);
+  const auto input = [&](uint32_t value, uint32_t bitlen, e_role owner) {
+    return (me == owner) ? BoolShare{gmw, value, bitlen, owner} : BoolShare{gmw, bitlen};
+  };
+
+  // Round-trip time: every AND gate of a chain needs its own round in GMW
+  BoolShare chain = input(1u, 1, SERVER);
+  const BoolShare other_bit = input(1u, 1, CLIENT);
+  for (uint32_t i = 0; i != ProbeDepth; ++i) chain &= other_bit;
+  out(chain, ALL);
+  party->ExecCircuit();
+  const double rtt = party->GetTiming(P_ONLINE) / 1e3 / ProbeDepth;
+  party->Reset();
+
+  // Bandwidth: the multiplication triples of many parallel AND gates are
+  // generated in the setup phase
+  vector<uint8_t> zeros(bitbytes(ProbeNumANDs));
+  const auto simd_input = [&](e_role owner) {
+    return (me == owner) ? BoolShare{gmw, zeros.data(), 1, owner, ProbeNumANDs}
+      : BoolShare{gmw, 1, ProbeNumANDs};
+  };
+  BoolShare ands = simd_input(SERVER);
+  ands &= simd_input(CLIENT);
+  out(ands, ALL);
+  party->ExecCircuit();
+  const double bytes = party->GetSentData(P_SETUP) + party->GetReceivedData(P_SETUP);
+  const double bandwidth = bytes / (party->GetTiming(P_SETUP) / 1e3);
+  party->Reset();
+  logger->debug("Measured RTT {} s, bandwidth {} B/s", rtt, bandwidth);
+
+  // Both parties need the same profile to make the same choices, so they
+  // agree on the slower of their measurements: the maximum round-trip time
+  // and time per MiB, both in microseconds.
+  const auto to_micros = [](double seconds) {
+    return static_cast<uint32_t>(clamp(llround(seconds * 1e6), 1ll,
+          static_cast<long long>(numeric_limits<uint32_t>::max())));
+  };
+  const uint32_t rtt_us = to_micros(rtt);
+  const uint32_t mib_us = to_micros((1 << 20) / bandwidth);
+  OutShare agreed_rtt = out(max(vector<BoolShare>{
+        input(rtt_us, 32, SERVER), input(rtt_us, 32, CLIENT)}), ALL);
+  OutShare agreed_mib = out(max(vector<BoolShare>{
+        input(mib_us, 32, SERVER), input(mib_us, 32, CLIENT)}), ALL);
+  party->ExecCircuit();
+  aby::NetworkProfile profile{agreed_rtt.get_clear_value<uint32_t>() / 1e6,
+    (1 << 20) * 1e6 / agreed_mib.get_clear_value<uint32_t>()};
+  party->Reset();
+  return profile;
+}
+
+void SecureEpilinker::choose_sharing(const size_t num_records,
+    const size_t database_size, const bool matching_mode) {
+  const auto shape = make_tuple(num_records, database_size, matching_mode);
+  auto choice = sharing_choices.find(shape);
+  if (choice == sharing_choices.end()) {
+    if (!network) {
+      throw runtime_error("Connect before building circuits in auto sharing mode!");
+    }
+    const auto& logger = get_logger();
+    // Streamed databases run the circuit of the chunk size once per chunk
+    const bool streamed = is_streamed(database_size);
+    const size_t circuit_size = streamed ? cfg.database_chunk_size : database_size;
+    const size_t num_circuits = (database_size + circuit_size - 1) / circuit_size;
+
+    pair<BooleanSharing, bool> best{cfg.bool_sharing, cfg.use_conversion};
+    double best_runtime = numeric_limits<double>::infinity();
+    for (const auto bool_sharing : {GMW, YAO}) {
+      for (const bool use_conversion : {false, true}) {
+        const auto& [ref, ref2] = reference_circuit_stats(bool_sharing,
+            use_conversion, matching_mode, streamed);
+        const auto stats = aby::extrapolate_circuit_stats(ref, ref2,
+            ReferenceDatabaseSize, num_records, circuit_size);
+
+        const double runtime = num_circuits * aby::predict_runtime(stats, *network, cfg.bitlen);
+        logger->debug("Predicted runtime for nrecords/dbsize {}/{} with {} and "
+            "use_conversion={}: {:.3f} s", num_records, database_size,
+            bool_sharing, use_conversion, runtime);
+        if (runtime < best_runtime) {
+          best_runtime = runtime;
+          best = {bool_sharing, use_conversion};
+        }
+      }
+    }
+    logger->info("Chose {} with use_conversion={} for nrecords/dbsize {}/{}",
+        best.first, best.second, num_records, database_size);
+    choice = sharing_choices.emplace(shape, best).first;
+  }
+  set_sharing(choice->second.first, choice->second.second);
+}
+
+const pair<aby::CircuitStats, aby::CircuitStats>&
+SecureEpilinker::reference_circuit_stats(const BooleanSharing bool_sharing,
+    const bool use_conversion, const bool matching_mode, const bool streamed) {
+  const auto variant_key = make_tuple(bool_sharing, use_conversion,
+      matching_mode, streamed);
+  auto stats = reference_stats.find(variant_key);
+  if (stats == reference_stats.end()) {
+    CircuitConfig variant = cfg;
+    variant.bool_sharing = bool_sharing;
+    variant.use_conversion = use_conversion;
+    const auto read_stats = [&](size_t database_size) {
+      const auto builder = make_unique_circuit_builder(variant,
+          bool_circuit(bool_sharing), bool_circuit(other(bool_sharing)), acirc);
+      // First chunk of a larger database
+      if (streamed) builder->set_database_chunk(0, 2 * database_size);
+      build_empty_circuit(*builder, 1, database_size, matching_mode);
+      const auto circuit_stats = aby::read_circuit_stats(*party);
+      party->Reset();
+      return circuit_stats;
+    };
+    stats = reference_stats.emplace(variant_key, make_pair(
+          read_stats(ReferenceDatabaseSize), read_stats(2 * ReferenceDatabaseSize))).first;
+  }
+  return stats->second;
+}
+
+void SecureEpilinker::set_sharing(BooleanSharing bool_sharing, bool use_conversion) {
+  if (cfg.bool_sharing == bool_sharing && cfg.use_conversion == use_conversion) return;
+  cfg.bool_sharing = bool_sharing;
+  cfg.use_conversion = use_conversion;
+  bcirc = bool_circuit(bool_sharing);
+  ccirc = bool_circuit(other(bool_sharing));
+
+  lock_guard<mutex> lock(saved_database_mutex);
+  selc = make_unique_circuit_builder(cfg, bcirc, ccirc, acirc);
+  // The new builder has no saved database shares to reuse. Both parties switch
+  // at the same time, so they both input the database again.
+  if (database_version) {
+    database_version->second = false;
+    selc->set_database_version(database_version->first, false);
+  }
 }
 
 State SecureEpilinker::get_state() {
@@ -74,18 +245,32 @@ State SecureEpilinker::get_state() {
 }
 
 void SecureEpilinker::build_linkage_circuit(const size_t num_records, const size_t database_size) {
-  build_circuit(num_records, database_size);
-  state.matching_mode = false;
+  build_circuit(num_records, database_size, false);
 }
 void SecureEpilinker::build_count_circuit(const size_t num_records, const size_t database_size) {
-  build_circuit(num_records, database_size);
-  state.matching_mode = true;
+  build_circuit(num_records, database_size, true);
 }
-void SecureEpilinker::build_circuit(const size_t num_records_, const size_t database_size_) {
+void SecureEpilinker::build_circuit(const size_t num_records_,
+    const size_t database_size_, const bool matching_mode_) {
+  if (state.setup) {
+    if (state.num_records == num_records_ && state.database_size == database_size_
+        && state.matching_mode == matching_mode_) {
+      get_logger()->debug("Using precomputed setup phase for nrecords/dbsize {}/{}",
+          num_records_, database_size_);
+      return;
+    }
+    // Precomputed material is useless for a different circuit shape. Both
+    // parties see the same job shapes, so they discard it simultaneously.
+    get_logger()->debug("Discarding precomputed setup phase for nrecords/dbsize {}/{}",
+        state.num_records, state.database_size);
+    reset();
+  }
+  if (cfg.auto_sharing) choose_sharing(num_records_, database_size_, matching_mode_);
   // TODO When separation of setup, online phase and input setting is done in
   // ABY, call selc->build_circuit() here instead of in run()
   state.num_records = num_records_;
   state.database_size = database_size_;
+  state.matching_mode = matching_mode_;
   state.built = true;
 }
 
@@ -104,30 +289,224 @@ void check_state_for_input(const State& state,
           " nrecords/dbsize is {}/{} but need {}/{}",
           state.num_records, state.database_size, input.num_records, input.database_size));
   }
+  // The precomputed setup material is only valid for the exact same circuit
+  if (state.setup && (state.num_records != input.num_records
+        || state.database_size != input.database_size)) {
+    throw runtime_error(format("Input doesn't match shape of setup phase!"
+          " nrecords/dbsize is {}/{} but got {}/{}",
+          state.num_records, state.database_size, input.num_records, input.database_size));
+  }
+}
+
+/**
+ * Inputs with only empty fields, used to build a circuit of the given shape
+ * during the setup phase.
+ */
+EpilinkClientInput make_empty_client_input(const EpilinkConfig& epi,
+    const size_t num_records, const size_t database_size) {
+  Record empty_record;
+  for (const auto& f : epi.fields) empty_record[f.first] = nullopt;
+  return {make_unique<Records>(num_records, empty_record), database_size};
+}
+
+EpilinkServerInput make_empty_server_input(const EpilinkConfig& epi,
+    const size_t num_records, const size_t database_size) {
+  auto empty_database = make_shared<VRecord>();
+  for (const auto& f : epi.fields) (*empty_database)[f.first] = VFieldEntry(database_size);
+  return {move(empty_database), num_records};
 }
 
 void SecureEpilinker::run_setup_phase() {
   throw_if_not_built(state.built, "running setup phase");
+  if (is_streamed(state.database_size)) {
+    get_logger()->debug("Streaming database of size {} in chunks, setup phase "
+        "runs with each chunk.", state.database_size);
+    return;
+  }
+  if (state.setup) {
+    get_logger()->trace("Setup phase already precomputed.");
+    return;
+  }
+  build_setup_circuit();
+  exec_setup_phase();
+}
+
+void SecureEpilinker::build_setup_circuit() {
+  get_logger()->trace("Building circuit for setup phase for nrecords/dbsize {}/{}...",
+      state.num_records, state.database_size);
+
+  // OTs, multiplication triples and garbled tables only depend on the shape of
+  // the circuit, so we build it with empty inputs of the same shape and only
+  // run ABY's setup phase, keeping the precomputed material in memory.
+  build_empty_circuit(*selc, state.num_records, state.database_size,
+      state.matching_mode);
+}
+
+void SecureEpilinker::build_empty_circuit(CircuitBuilderBase& builder,
+    const size_t num_records, const size_t database_size, const bool matching_mode) {
+  if (role == MPCRole::CLIENT) {
+    builder.set_input(make_empty_client_input(cfg.epi, num_records, database_size));
+  } else {
+    builder.set_input(make_empty_server_input(cfg.epi, num_records, database_size));
+  }
+  if (matching_mode) builder.build_count_circuit();
+  else builder.build_linkage_circuit();
+}
+
+void SecureEpilinker::exec_setup_phase() {
+  const auto& logger = get_logger();
+  logger->trace("Running setup phase...");
+  party->SetPreCompPhaseValue(ePreCompRAMWrite);
+  party->ExecCircuit();
+  // Throw away the shape circuit. The next ExecCircuit() of the same circuit
+  // with real inputs only runs the online phase.
+  selc->reset();
+  party->Reset();
+  party->SetPreCompPhaseValue(ePreCompRAMRead);
+
   state.setup = true;
+  logger->trace("Setup phase finished.");
+}
+
+size_t SecureEpilinker::estimate_setup_memory() const {
+  // Yao: two ciphertexts of 128 bit per AND gate (half-gates)
+  // GMW: one multiplication triple of three bits per AND gate
+  // Arithmetic: one multiplication triple of three ring elements per MUL gate
+  const auto ycirc = (cfg.bool_sharing == YAO) ? bcirc : ccirc;
+  const auto gcirc = (cfg.bool_sharing == GMW) ? bcirc : ccirc;
+  return size_t{ycirc->GetNumANDGates()} * 2 * 16
+    + bitbytes(size_t{gcirc->GetNumANDGates()} * 3)
+    + size_t{acirc->GetNumMULGates()} * 3 * bitbytes(cfg.bitlen);
+}
+
+void SecureEpilinker::run_idle_setup_phase() {
+  if (!precomp_budget || !last_shape || state.built) return;
+  const auto& logger = get_logger();
+  const auto [num_records, database_size, matching_mode] = *last_shape;
+  if (is_streamed(database_size)) return;
+
+  build_circuit(num_records, database_size, matching_mode);
+  build_setup_circuit();
+  const auto memory = estimate_setup_memory();
+  if (memory > precomp_budget) {
+    logger->debug("Not precomputing setup phase for nrecords/dbsize {}/{}: "
+        "estimated {} bytes exceed budget of {} bytes.",
+        num_records, database_size, memory, precomp_budget);
+    reset();
+    return;
+  }
+
+  logger->debug("Precomputing setup phase for nrecords/dbsize {}/{} "
+      "(estimated {} bytes)", num_records, database_size, memory);
+  exec_setup_phase();
 }
 
 void SecureEpilinker::set_client_input(const EpilinkClientInput& input) {
   check_state_for_input(state, input);
-  selc->set_input(input);
+  if (is_streamed(state.database_size)) {
+    stream_client_input.emplace(make_unique<Records>(*input.records),
+        input.database_size);
+  } else {
+    selc->set_input(input);
+  }
   state.input_set = true;
 }
 
 void SecureEpilinker::set_server_input(const EpilinkServerInput& input) {
   check_state_for_input(state, input);
-  selc->set_input(input);
+  if (is_streamed(state.database_size)) stream_server_input = input;
+  else selc->set_input(input);
   state.input_set = true;
 }
 
+bool SecureEpilinker::is_streamed(size_t database_size) const {
+  return cfg.database_chunk_size && database_size > cfg.database_chunk_size;
+}
+
+/**
+ * Server input of the database rows [offset, offset+size)
+ */
+EpilinkServerInput database_chunk(const EpilinkServerInput& input,
+    const size_t offset, const size_t size) {
+  shared_ptr<VRecord> chunk;
+  if (input.database) {
+    chunk = make_shared<VRecord>();
+    for (const auto& [name, column] : *input.database) {
+      const auto first = column.cbegin() + offset;
+      chunk->emplace(name, VFieldEntry(first, first + size));
+    }
+  }
+  shared_ptr<FieldColumns> chunk_columns;
+  if (input.columns) {
+    chunk_columns = make_shared<FieldColumns>();
+    for (const auto& [name, column] : *input.columns) {
+      chunk_columns->emplace(name, FieldColumn{column, offset, size});
+    }
+  }
+  return {move(chunk), input.num_records, move(chunk_columns)};
+}
+
+void SecureEpilinker::set_chunk_input(const size_t offset, const size_t size) {
+  if (stream_client_input) {
+    selc->set_input(EpilinkClientInput{
+        make_unique<Records>(*stream_client_input->records), size});
+  } else {
+    selc->set_input(database_chunk(*stream_server_input, offset, size));
+  }
+}
+
+void SecureEpilinker::run_leading_chunks() {
+  const auto& logger = get_logger();
+  const size_t database_size = stream_client_input ?
+    stream_client_input->database_size : stream_server_input->database_size;
+  const size_t chunk_size = cfg.database_chunk_size;
+
+  for (size_t offset = 0; ; offset += chunk_size) {
+    const size_t size = min(chunk_size, database_size - offset);
+    selc->set_database_chunk(offset, database_size);
+    set_chunk_input(offset, size);
+    if (offset + size == database_size) break; // last chunk is run by caller
+
+    logger->trace("Executing ABYParty Circuit of database chunk {}-{}/{}...",
+        offset, offset + size, database_size);
+    if (state.matching_mode) selc->build_count_circuit();
+    else selc->build_linkage_circuit();
+    party->ExecCircuit();
+    selc->save_running_best();
+    // Next chunk needs a fresh circuit
+    selc->reset();
+    party->Reset();
+  }
+
+  stream_client_input.reset();
+  stream_server_input.reset();
+}
+
+void SecureEpilinker::set_database_version(uint64_t version, bool reuse) {
+  const auto new_version = make_pair(version, reuse);
+  if (state.setup && database_version != new_version) {
+    // Reusing shares changes the circuit
+    get_logger()->debug("Discarding precomputed setup phase for different "
+        "database version {:x}", version);
+    reset();
+  }
+  database_version = new_version;
+  selc->set_database_version(version, reuse);
+}
+
+std::optional<uint64_t> SecureEpilinker::get_saved_database_version() const {
+  lock_guard<mutex> lock(saved_database_mutex);
+  return selc->saved_database_version();
+}
+
 #ifdef DEBUG_SEL_CIRCUIT
 void SecureEpilinker::set_both_inputs(
     const EpilinkClientInput& in_client, const EpilinkServerInput& in_server) {
+  if (is_streamed(state.database_size)) {
+    throw runtime_error("Setting both inputs is not supported in streaming mode.");
+  }
   assert(in_client.num_records == in_server.num_records
-      && in_client.database_size == in_server.database_size)
+      && in_client.database_size == in_server.database_size);
   check_state_for_input(state, in_client);
   selc->set_both_inputs(in_client, in_server);
   state.input_set = true;
@@ -138,7 +517,8 @@ Result<CircUnit> to_clear_value(LinkageOutputShares& res, [[maybe_unused]] size_
 #ifdef DEBUG_SEL_RESULT
     const auto sum_field_weights = res.score_numerator.get_clear_value<CircUnit>();
     // shift by dice-precision to account for precision of threshold, i.e.,
-    // get denominator and numerator to same scale
+    // get denominator and numerator to same scale. In division-free dice mode,
+    // dice_prec is 0 here because they already are on the same scale.
     const auto sum_weights = res.score_denominator.get_clear_value<CircUnit>() << dice_prec;
 #else
     const CircUnit sum_field_weights = 0;
@@ -155,20 +535,27 @@ Result<CircUnit> to_clear_value(LinkageOutputShares& res, [[maybe_unused]] size_
 
 
 vector<Result<CircUnit>> SecureEpilinker::run_linkage() {
-  if (!state.setup) {
-    get_logger()->warn(
-        "SecureEpilinker::run_linkage: Implicitly running setup phase.");
-    run_setup_phase();
+  if (is_streamed(state.database_size)) {
+    run_leading_chunks();
+  } else if (!state.setup) {
+    get_logger()->warn("SecureEpilinker::run_linkage: No setup phase was run, "
+        "running setup and online phase together.");
   }
 
   auto results = selc->build_linkage_circuit();
   get_logger()->trace("Executing ABYParty Circuit...");
   party->ExecCircuit();
   get_logger()->trace("ABYParty Circuit executed.");
+  {
+    lock_guard<mutex> lock(saved_database_mutex);
+    selc->save_database_shares();
+  }
 
-  auto clear_results = transform_vec(results, [dice_prec=cfg.dice_prec](auto r){
+  const size_t dice_prec = cfg.division_free_dice ? 0 : cfg.dice_prec;
+  auto clear_results = transform_vec(results, [dice_prec](auto r){
         return to_clear_value(r, dice_prec);
       });
+  last_shape = {state.num_records, state.database_size, state.matching_mode};
   state.reset(); // need to setup new circuit
   return clear_results;
 }
@@ -181,18 +568,23 @@ CountResult<CircUnit> to_clear_value(CountOutputShares& res) {
 }
 
 CountResult<CircUnit> SecureEpilinker::run_count() {
-  if (!state.setup) {
-    get_logger()->warn(
-        "SecureEpilinker::run_count: Implicitly running setup phase.");
-    run_setup_phase();
-
+  if (is_streamed(state.database_size)) {
+    run_leading_chunks();
+  } else if (!state.setup) {
+    get_logger()->warn("SecureEpilinker::run_count: No setup phase was run, "
+        "running setup and online phase together.");
   }
   auto results = selc->build_count_circuit();
   get_logger()->trace("Executing ABYParty Circuit...");
   party->ExecCircuit();
   get_logger()->trace("ABYParty Circuit executed.");
+  {
+    lock_guard<mutex> lock(saved_database_mutex);
+    selc->save_database_shares();
+  }
 
   auto clear_results = to_clear_value(results);
+  last_shape = {state.num_records, state.database_size, state.matching_mode};
   state.reset(); // need to setup new circuit
   return clear_results;
 }
@@ -206,8 +598,11 @@ void SecureEpilinker::State::reset() {
 }
 
 void SecureEpilinker::reset() {
+  stream_client_input.reset();
+  stream_server_input.reset();
   selc->reset();
   party->Reset();
+  party->SetPreCompPhaseValue(ePreCompDefault);
   state.reset();
 }
 
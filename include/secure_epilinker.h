@@ -20,10 +20,14 @@
 #define SEL_SECURE_EPILINKER_H
 #pragma once
 
+#include <mutex>
+#include <map>
+#include <tuple>
 #include "fmt/format.h"
 #include "epilink_input.h"
 #include "epilink_result.hpp"
 #include "circuit_config.h"
+#include "aby/cost_model.h"
 #ifdef SEL_STATS
 #include "aby/statsprinter.h"
 #endif
@@ -46,6 +50,9 @@ public:
     std::string host; // local for role SERVER, remote for role CLIENT
     uint16_t port;
     uint32_t nthreads;
+    // Memory budget in bytes for precomputing setup phases while idle.
+    // 0 disables idle precomputation.
+    size_t precomp_budget{0};
   };
 
   struct State {
@@ -66,23 +73,45 @@ public:
   /**
    * Opens the network connection of two SecureEpilinkers as specified in the
    * ABY configuration. This is a blocking call.
+   * In auto sharing mode, the parties then measure the round-trip time and
+   * bandwidth between them and agree on the slower measurements. For each new
+   * circuit shape, the runtime of all combinations of boolean sharing and
+   * arithmetic conversion is then predicted, and the combination with the
+   * least predicted runtime is used for this shape, see aby::predict_runtime().
+   * The predictions are extrapolated from small reference circuits, which are
+   * only built once per combination.
    */
   void connect();
 
   void build_linkage_circuit(const size_t num_records, const size_t database_size);
   void build_count_circuit(const size_t num_records, const size_t database_size);
 
-  /*
-   * TODO The separation of setup and online phase is currently not possible in
-   * ABY. Until it is, this will all happen in the run_* methods...
+  /**
+   * Runs the input-independent setup phase (OTs, multiplication triples,
+   * garbled tables) for the circuit shape given to build_*_circuit(). Both
+   * parties need to call this. The inputs set afterwards need to have exactly
+   * the built shape and run_*() then only runs the online phase.
+   * If skipped, run_*() runs setup and online phase together.
    */
   void run_setup_phase();
 
+  /**
+   * Precomputes the setup phase for the shape of the last run circuit, if its
+   * estimated memory usage fits into the configured precomputation budget.
+   * A following build_*_circuit() of the same shape then already is set up,
+   * other shapes discard the precomputation.
+   * Both parties need to call this at the same point, e.g., after reset(), and
+   * need to be configured with the same budget.
+   */
+  void run_idle_setup_phase();
+
   /**
    * Interactively runs the circuit with given inputs and returns max index as
    * XOR share to be sent to linkage service by the caller.
    * database size must match on both sides and be smaller than used nvals
    * during build_circuit()
+   * If the database is larger than the configured database chunk size, the
+   * inputs are kept and streamed chunk-wise through the circuit by run_*().
    */
   void set_client_input(const EpilinkClientInput& input);
   void set_server_input(const EpilinkServerInput& input);
@@ -91,6 +120,20 @@ public:
       const EpilinkServerInput& in_server);
 #endif
 
+  /**
+   * Sets the version of the server database of the following runs and whether
+   * the secret-shared database saved during an earlier run of the same version
+   * is to be reused, so that the server doesn't need to input it again.
+   * Both parties need to set the same values before building the circuit.
+   * Only effective with GMW as boolean sharing and without batched records.
+   */
+  void set_database_version(uint64_t version, bool reuse);
+  /**
+   * Version of the saved secret-shared database. Thread-safe, so it may be
+   * queried while a circuit is run, e.g., when preparing the next job.
+   */
+  std::optional<uint64_t> get_saved_database_version() const;
+
   /**
    * Multiple dispatch versions of set_*_input()
    */
@@ -112,28 +155,114 @@ public:
 #endif
 
 private:
+  const MPCRole role;
+  const size_t precomp_budget;
   std::unique_ptr<ABYParty> party;
   BooleanCircuit* bcirc; // boolean circuit for boolean parts
   BooleanCircuit* ccirc; // intermediate conversion circuit
   ArithmeticCircuit* acirc;
-  const CircuitConfig cfg;
+  // In auto sharing mode, bool_sharing and use_conversion are the ones chosen
+  // for the current circuit shape
+  CircuitConfig cfg;
 
   std::unique_ptr<CircuitBuilderBase> selc; // ~pimpl
 
   /*
-   * Note that we currently maintain an outside-facing state that behaves as if
-   * aby already has the separation of circuit building/setup/input setting.
-   * The SELCircuit has its own real state. Hence, once properly implemented on
-   * aby's side, we can delete this public fake state.
+   * Note that we maintain an outside-facing state that behaves as if aby
+   * had the separation of circuit building/setup/input setting. The circuit
+   * is actually built twice: once with empty inputs for the setup phase and
+   * once with the real inputs in run_*().
    */
   State state;
 
+  struct Shape {
+    size_t num_records, database_size;
+    bool matching_mode;
+  };
+  // Shape of the last run circuit, for idle precomputation
+  std::optional<Shape> last_shape;
+  // Database version and reuse flag the circuit is built with
+  std::optional<std::pair<uint64_t, bool>> database_version;
+  // Guards the saved database shares
+  mutable std::mutex saved_database_mutex;
+  // Auto sharing mode: network between the parties and chosen boolean sharing
+  // and conversion by shape {num_records, database_size, matching_mode}
+  std::optional<aby::NetworkProfile> network;
+  std::map<std::tuple<size_t, size_t, bool>, std::pair<BooleanSharing, bool>>
+    sharing_choices;
+  // Auto sharing mode: statistics of the two reference circuits by
+  // {bool_sharing, use_conversion, matching_mode, streamed}
+  std::map<std::tuple<BooleanSharing, bool, bool, bool>,
+    std::pair<aby::CircuitStats, aby::CircuitStats>> reference_stats;
+  // Streaming mode: inputs of the whole database, set chunk-wise in run_*()
+  std::optional<EpilinkClientInput> stream_client_input;
+  std::optional<EpilinkServerInput> stream_server_input;
+
+  /**
+   * Whether a database of given size is streamed in chunks
+   */
+  bool is_streamed(size_t database_size) const;
+
+  /**
+   * Streaming mode: Runs the circuits of all but the last database chunk, each
+   * passing on the secret-shared running best to the next chunk, and sets the
+   * input of the last chunk, which is then built and run as usual.
+   */
+  void run_leading_chunks();
+  void set_chunk_input(size_t offset, size_t size);
+
   /*
    * TODO It is currently not possible to build an ABY circuit without
    * specifying the inputs, as all circuits start with the InputGates. Hence,
    * the actual circuit building will happen in run_*.
    */
-  void build_circuit(const size_t num_records, const size_t database_size);
+  void build_circuit(const size_t num_records, const size_t database_size,
+      const bool matching_mode);
+
+  /**
+   * Builds the circuit of the current state's shape with empty inputs and runs
+   * the setup phase, keeping the precomputed material in RAM.
+   */
+  void build_setup_circuit();
+  /**
+   * Builds the circuit of given shape with empty inputs using given builder
+   */
+  void build_empty_circuit(CircuitBuilderBase& builder, size_t num_records,
+      size_t database_size, bool matching_mode);
+
+  /**
+   * Auto sharing mode: Measures the network between the parties, see
+   * connect().
+   */
+  aby::NetworkProfile probe_network();
+  /**
+   * Auto sharing mode: Switches to the boolean sharing and conversion with the
+   * least predicted runtime for circuits of given shape. The choice is cached
+   * per shape. The runtimes are predicted from circuit statistics extrapolated
+   * from small reference circuits, see aby::extrapolate_circuit_stats().
+   */
+  void choose_sharing(size_t num_records, size_t database_size, bool matching_mode);
+  /**
+   * Auto sharing mode: Statistics of the two reference circuits of a single
+   * record and a database of a few and twice as many entries for given
+   * variant. They are only built the first time they are needed.
+   */
+  const std::pair<aby::CircuitStats, aby::CircuitStats>& reference_circuit_stats(
+      BooleanSharing bool_sharing, bool use_conversion, bool matching_mode,
+      bool streamed);
+  /**
+   * Switches the circuit builder to given boolean sharing and conversion. The
+   * database shares saved by the previous builder are lost.
+   */
+  void set_sharing(BooleanSharing bool_sharing, bool use_conversion);
+  BooleanCircuit* bool_circuit(BooleanSharing bool_sharing) const;
+  void exec_setup_phase();
+
+  /**
+   * Rough estimate of the memory in bytes that the precomputed material of the
+   * currently built circuit takes up.
+   */
+  size_t estimate_setup_memory() const;
 };
 
 } // namespace sel
@@ -148,10 +277,10 @@ struct formatter<sel::SecureEpilinker::ABYConfig> {
   template <typename FormatContext>
   auto format(const sel::SecureEpilinker::ABYConfig& conf, FormatContext &ctx) {
     return format_to(ctx.begin(),
-        "ABYConfig{{role={}, sharing={}, {}={}:{}, threads={}}}",
+        "ABYConfig{{role={}, sharing={}, {}={}:{}, threads={}, precomp_budget={}}}",
         ((conf.role == sel::MPCRole::SERVER) ? "Server" : "Client"),
         ((conf.role == sel::MPCRole::SERVER) ? "binding to" : "remote host"),
-        conf.host, conf.port, conf.nthreads);
+        conf.host, conf.port, conf.nthreads, conf.precomp_budget);
   }
 };
 
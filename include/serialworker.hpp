@@ -25,6 +25,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include <functional>
 
 namespace sel {
@@ -52,7 +53,10 @@ public:
   }
 
   void interrupt() {
+    std::unique_lock<std::mutex> mlock(mutex_);
     interrupted = true;
+    mlock.unlock();
+    cond_.notify_all();
   }
 
   void join() {
@@ -64,11 +68,13 @@ public:
   SerialWorker& operator=(const SerialWorker&) = delete;
 
 private:
-  std::thread thread_;
   std::queue<std::shared_ptr<T>> queue_;
   std::mutex mutex_;
   std::condition_variable cond_;
-  bool interrupted = false;
+  std::atomic_bool interrupted{false};
+  // Declared last, so that the worker loop starts after all other members
+  // are initialized
+  std::thread thread_;
 
   void worker_loop(const JobConsumer job_consumer) {
     do {
@@ -80,6 +86,8 @@ private:
       if (interrupted) return;
       auto job = queue_.front();
       queue_.pop();
+      // Don't block pushing of new jobs while consuming this one
+      mlock.unlock();
 
       job_consumer(job);
 
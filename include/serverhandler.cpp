@@ -38,7 +38,12 @@ using namespace std;
 
 namespace sel {
 
-void run_job(const shared_ptr<LinkageJob>& job) {
+bool prepare_job(const shared_ptr<LinkageJob>& job) {
+  job->prepare();
+  return job->get_status() != JobStatus::FAULT;
+}
+
+bool run_job(const shared_ptr<LinkageJob>& job) {
   assert (job->get_status() == JobStatus::QUEUED && "Only queued jobs can be run!");
 
   const auto& remote_id = job->get_remote_id();
@@ -55,11 +60,26 @@ void run_job(const shared_ptr<LinkageJob>& job) {
     throw runtime_error("Attempt to run matching job but matching mode not compiled!");
 #endif
   }
+  return job->get_status() != JobStatus::FAULT;
+}
+
+bool finish_job(const shared_ptr<LinkageJob>& job) {
+  job->finish();
+  return true;
 }
 
 ServerHandler::~ServerHandler() {
-  for (auto& worker_thread : m_worker_threads) {
-    worker_thread.second.join();
+  for (auto& lanes : m_worker_threads) {
+    for (auto& worker_thread : lanes.second) {
+      worker_thread->interrupt();
+      worker_thread->join();
+    }
+  }
+  for (auto& lanes : m_server_threads) {
+    for (auto& server_thread : lanes.second) {
+      server_thread->interrupt();
+      server_thread->join();
+    }
   }
 }
 
@@ -81,18 +101,25 @@ void ServerHandler::insert_client(RemoteId id) {
     m_logger->warn("Client created with matching mode allowed!");
   }
   auto server_config{config_handler.get_server_config()};
-  SecureEpilinker::ABYConfig aby_config{
-    MPCRole::CLIENT, remote_config->get_remote_host(),
-      remote_config->get_aby_port(), server_config.aby_threads};
-  m_logger->debug("Creating client on port {}, remote host: {}", aby_config.port, aby_config.host);
-  m_aby_clients.emplace(id, make_shared<SecureEpilinker>(aby_config,circuit_config));
-
-  m_logger->debug("Creating worker thread for remote {}", id);
-  m_worker_threads.emplace(id, run_job);
+  vector<shared_ptr<SecureEpilinker>> clients;
+  vector<unique_ptr<PipelinedWorker<LinkageJob>>> workers;
+  for (const auto port : remote_config->get_aby_ports()) {
+    SecureEpilinker::ABYConfig aby_config{
+      MPCRole::CLIENT, remote_config->get_remote_host(),
+        port, server_config.aby_threads,
+        server_config.idle_precomputation_budget};
+    m_logger->debug("Creating client on port {}, remote host: {}", aby_config.port, aby_config.host);
+    clients.emplace_back(make_shared<SecureEpilinker>(aby_config,circuit_config));
+    workers.emplace_back(make_unique<PipelinedWorker<LinkageJob>>(
+          prepare_job, run_job, finish_job));
+  }
+  m_logger->debug("Created {} worker lanes for remote {}", workers.size(), id);
+  m_aby_clients.emplace(id, move(clients));
+  m_worker_threads.emplace(id, move(workers));
   connect_client(id);
 }
 
-void ServerHandler::insert_server(RemoteId id, RemoteAddress remote_address) {
+void ServerHandler::insert_server(RemoteId id, const vector<Port>& ports) {
   const auto& config_handler{ConfigurationHandler::cget()};
   auto local_config{config_handler.get_local_config()};
   auto remote_config{config_handler.get_remote_config(id)};
@@ -101,20 +128,41 @@ void ServerHandler::insert_server(RemoteId id, RemoteAddress remote_address) {
     m_logger->warn("Server created with matching mode allowed!");
   }
   auto server_config{config_handler.get_server_config()};
-  SecureEpilinker::ABYConfig aby_config{
-    MPCRole::SERVER, ConfigurationHandler::cget().get_server_config().bind_address,
-      remote_address.port, server_config.aby_threads};
-  m_logger->debug("Creating server on port {}, bound to: {}\n", aby_config.port, aby_config.host);
-  m_server.emplace(id, make_shared<LocalServer>(id, aby_config, circuit_config));
-  get_local_server(id)->connect_server();
+  vector<shared_ptr<LocalServer>> servers;
+  vector<unique_ptr<SerialWorker<ServerRun>>> workers;
+  for (const auto port : ports) {
+    SecureEpilinker::ABYConfig aby_config{
+      MPCRole::SERVER, server_config.bind_address,
+        port, server_config.aby_threads,
+        server_config.idle_precomputation_budget};
+    m_logger->debug("Creating server on port {}, bound to: {}\n", aby_config.port, aby_config.host);
+    servers.emplace_back(make_shared<LocalServer>(id, aby_config, circuit_config));
+    workers.emplace_back(make_unique<SerialWorker<ServerRun>>(
+          [this](const shared_ptr<ServerRun>& run) {
+            run_server(run->remote_id, run->lane, run->data, run->num_records,
+                run->counting_mode, run->reuse_shares);
+          }));
+  }
+  m_server.emplace(id, move(servers));
+  m_server_threads.emplace(id, move(workers));
+  // The remote client connects its lanes in the same order
+  for (auto& server : m_server.at(id)) server->connect_server();
 }
 
 void ServerHandler::add_linkage_job(const RemoteId& remote_id, const std::shared_ptr<LinkageJob>& job){
   const auto& config_handler = ConfigurationHandler::cget();
   const auto job_id = job->get_id();
   if(config_handler.get_remote_config(remote_id)->get_mutual_initialization_status()) {
-    m_client_jobs.emplace(job_id, job);
-    m_worker_threads.at(remote_id).push(job);
+    auto& workers = m_worker_threads.at(remote_id);
+    {
+      lock_guard<mutex> lock(m_job_mutex);
+      m_client_jobs.emplace(job_id, job);
+      auto& lane = m_next_lane[remote_id];
+      job->set_lane(lane);
+      lane = (lane + 1) % workers.size();
+    }
+    m_logger->debug("Queueing job {} on lane {}", job_id, job->get_lane());
+    workers.at(job->get_lane())->push(job);
   } else {
     m_logger->error("Can not create linkage job {}: Connection to remote "
         "Secure EpiLinker {} is not properly initialized.", job_id, remote_id);
@@ -122,12 +170,14 @@ void ServerHandler::add_linkage_job(const RemoteId& remote_id, const std::shared
 }
 
 shared_ptr<const LinkageJob> ServerHandler::get_linkage_job(const JobId& j_id) const {
+  lock_guard<mutex> lock(m_job_mutex);
   return m_client_jobs.at(j_id);
 }
 
 string ServerHandler::get_job_status(const JobId& j_id) const {
   if (j_id == "list"){ // Generate job status listing
     nlohmann::json result;
+    lock_guard<mutex> lock(m_job_mutex);
     for(const auto& job : m_client_jobs) {
       result[job.first] = js_enum_to_string(job.second->get_status());
     }
@@ -138,29 +188,34 @@ string ServerHandler::get_job_status(const JobId& j_id) const {
 
 }
 
-Port ServerHandler::get_server_port(const RemoteId& id) const {
-  return m_server.at(id)->get_port();
+size_t ServerHandler::get_num_server_lanes(const RemoteId& id) const {
+  return m_server.at(id).size();
 }
 
-shared_ptr<SecureEpilinker> ServerHandler::get_epilink_client(const RemoteId& remote_id){
-  return m_aby_clients.at(remote_id);
+Port ServerHandler::get_server_port(const RemoteId& id, size_t lane) const {
+  return get_local_server(id, lane)->get_port();
 }
 
-std::shared_ptr<LocalServer> ServerHandler::get_local_server(const RemoteId& remote_id) const {
-  return m_server.at(remote_id);
+shared_ptr<SecureEpilinker> ServerHandler::get_epilink_client(const RemoteId& remote_id, size_t lane){
+  return m_aby_clients.at(remote_id).at(lane);
 }
 
-void ServerHandler::run_server(const RemoteId& remote_id,
+std::shared_ptr<LocalServer> ServerHandler::get_local_server(const RemoteId& remote_id, size_t lane) const {
+  return m_server.at(remote_id).at(lane);
+}
+
+void ServerHandler::run_server(const RemoteId& remote_id, size_t lane,
                                std::shared_ptr<const ServerData> data,
-                               size_t num_records, bool counting_mode) {
+                               size_t num_records, bool counting_mode,
+                               bool reuse_shares) {
   const auto& config_handler{ConfigurationHandler::cget()};
   auto remote_config{config_handler.get_remote_config(remote_id)};
   auto local_config{config_handler.get_local_config()};
   if (remote_config->get_mutual_initialization_status()) {
     if (!counting_mode) {
-      get_local_server(remote_id)->run_linkage(move(data), num_records);
+      get_local_server(remote_id, lane)->run_linkage(move(data), num_records, reuse_shares);
     } else if(remote_config->get_matching_mode()){ // Matching mode
-      get_local_server(remote_id)->run_count(move(data), num_records);
+      get_local_server(remote_id, lane)->run_count(move(data), num_records, reuse_shares);
     } else {
       m_logger->error("Matching mode not allowed for remote");
     }
@@ -172,8 +227,16 @@ void ServerHandler::run_server(const RemoteId& remote_id,
   }
 }
 
+void ServerHandler::queue_server_run(const RemoteId& remote_id, size_t lane,
+                                     std::shared_ptr<const ServerData> data,
+                                     size_t num_records, bool counting_mode,
+                                     bool reuse_shares) {
+  m_server_threads.at(remote_id).at(lane)->push(make_shared<ServerRun>(ServerRun{
+        remote_id, lane, move(data), num_records, counting_mode, reuse_shares}));
+}
+
 void ServerHandler::connect_client(const RemoteId& remote_id) {
-  m_aby_clients.at(remote_id)->connect();
+  for (auto& client : m_aby_clients.at(remote_id)) client->connect();
 }
 
 }  // namespace sel
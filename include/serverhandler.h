@@ -24,9 +24,12 @@
 #include "resttypes.h"
 #include "connectionhandler.h"
 #include "serialworker.hpp"
+#include "pipelinedworker.hpp"
 #include "logger.h"
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace sel {
 
@@ -36,27 +39,58 @@ class ConfigurationHandler;
 class DataHandler;
 class SecureEpilinker;
 
+/**
+ * Parameters of a server run, queued by ServerHandler::queue_server_run()
+ */
+struct ServerRun {
+  RemoteId remote_id;
+  size_t lane;
+  std::shared_ptr<const ServerData> data;
+  size_t num_records;
+  bool counting_mode;
+  bool reuse_shares;
+};
+
 class ServerHandler {
   public:
     static ServerHandler& get();
     static ServerHandler const& cget();
+    /**
+     * Creates a SecureEpilinker client and job worker for each MPC lane of the
+     * remote, that is, for each of its ABY ports. Jobs are spread over the
+     * lanes, so that independent jobs run in parallel.
+     */
     void insert_client(RemoteId);
-    void insert_server(RemoteId, RemoteAddress);
+    /**
+     * Creates a local server for each MPC lane, listening on the given ports
+     */
+    void insert_server(RemoteId, const std::vector<Port>&);
     void add_linkage_job(const RemoteId&, const std::shared_ptr<LinkageJob>&);
     std::shared_ptr<const LinkageJob> get_linkage_job(const JobId&) const;
     std::string get_job_status(const JobId&) const;
-    std::shared_ptr<LocalServer> get_local_server(const RemoteId&) const;
-    Port get_server_port(const RemoteId&) const;
-    std::shared_ptr<SecureEpilinker> get_epilink_client(const RemoteId&);
-    void run_server(const RemoteId&, std::shared_ptr<const ServerData>, size_t, bool);
+    size_t get_num_server_lanes(const RemoteId&) const;
+    std::shared_ptr<LocalServer> get_local_server(const RemoteId&, size_t lane = 0) const;
+    Port get_server_port(const RemoteId&, size_t lane = 0) const;
+    std::shared_ptr<SecureEpilinker> get_epilink_client(const RemoteId&, size_t lane = 0);
+    void run_server(const RemoteId&, size_t, std::shared_ptr<const ServerData>, size_t, bool, bool);
+    /**
+     * Queues a server run for the given remote and lane. Runs of a lane are
+     * executed serially in the order they were queued, which matches the order
+     * of the jobs of the remote client's lane.
+     */
+    void queue_server_run(const RemoteId&, size_t, std::shared_ptr<const ServerData>, size_t, bool, bool);
     void connect_client(const RemoteId&);
   protected:
     ServerHandler() = default;
   private:
     ~ServerHandler();
-    std::map<RemoteId, std::shared_ptr<SecureEpilinker>> m_aby_clients;
-    std::map<RemoteId, std::shared_ptr<LocalServer>> m_server;
-    std::map<RemoteId, SerialWorker<LinkageJob>> m_worker_threads;
+    // All per-remote vectors are indexed by MPC lane
+    std::map<RemoteId, std::vector<std::shared_ptr<SecureEpilinker>>> m_aby_clients;
+    std::map<RemoteId, std::vector<std::shared_ptr<LocalServer>>> m_server;
+    std::map<RemoteId, std::vector<std::unique_ptr<PipelinedWorker<LinkageJob>>>> m_worker_threads;
+    std::map<RemoteId, std::vector<std::unique_ptr<SerialWorker<ServerRun>>>> m_server_threads;
+    std::map<RemoteId, size_t> m_next_lane; // round-robin lane of next job
+    mutable std::mutex m_job_mutex; // guards m_client_jobs and m_next_lane
     std::map<JobId, std::shared_ptr<LinkageJob>> m_client_jobs; // for status retrieval
     std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::SERVER)};
 };
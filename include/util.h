@@ -74,6 +74,20 @@ std::vector<T> repeat_vec(const std::vector<T>& v, const size_t n) {
   return c;
 }
 
+/**
+ * Repeats each element of the vector n times, i.e., {a, b} becomes
+ * {a, a, b, b} for n=2.
+ */
+template <typename T>
+std::vector<T> repeat_each_vec(const std::vector<T>& v, const size_t n) {
+  std::vector<T> c;
+  c.reserve(v.size() * n);
+  for (const auto& x : v) {
+    c.insert(c.end(), n, x);
+  }
+  return c;
+}
+
 /**
  * Generates a bitmaks of given size (rounded up to next multiple of 8) with
  * given bit set at all positions.
@@ -86,6 +100,15 @@ std::vector<uint8_t> vector_bool_to_bitmask(const std::vector<bool>&);
  * Hammingweight/popcount of bitmask
  */
 size_t hw(const Bitmask& bm);
+size_t hw(const uint8_t* bm, const size_t size);
+
+/**
+ * Hammingweight of bitwise AND of both bitmasks of given byte size, without
+ * materializing the AND. Runs an AVX-512 VPOPCNTDQ kernel if the CPU supports
+ * it, chosen at runtime, and a portable 64-bit word kernel otherwise.
+ */
+size_t bm_and_hw(const uint8_t* left, const uint8_t* right,
+    const size_t size);
 
 /**
  * Performs bitwise AND (&) on both bitmasks' bits
@@ -213,10 +213,80 @@ struct ABYTester {
     BoolShare bAND = in & in2;
     print_share(bAND, "in & in2");
 
-    in = hammingweight(bAND);
-    print_share(in, "hw");
+    BoolShare hw = hammingweight(bAND);
+    print_share(hw, "hw");
+    // Cross-check depth-optimized hammingweight
+    BoolShare low_depth_hw = low_depth_hammingweight(bAND);
+    print_share(low_depth_hw, "low-depth hw");
+    OutShare out_hw = out(hw, ALL), out_low_depth_hw = out(low_depth_hw, ALL);
 
     party.ExecCircuit();
+
+    cout << dec;
+    const auto res = out_hw.get_clear_value_vec();
+    const auto res_low_depth = out_low_depth_hw.get_clear_value_vec();
+    for (size_t i = 0; i != data.size(); ++i) {
+      const uint32_t expected = __builtin_popcount(data[i] & data2[i]);
+      const bool ok = res[i] == expected && res_low_depth[i] == expected;
+      print("hw: {} | low-depth hw: {} (expected {}){}\n", res[i],
+          res_low_depth[i], expected, ok ? "" : " MISMATCH");
+    }
+  }
+
+  /**
+   * Cross-checks low_depth_hammingweight() of the AND of random 500 and 1000
+   * bit bitmasks against __builtin_popcount(). Both parties generate the same
+   * random bitmasks from the shared seed.
+   */
+  void test_bitmask_hw() {
+    const vector<size_t> bm_bitsizes{500, 1000};
+    uniform_int_distribution<unsigned> random_byte(0, 0xff);
+    vector<pair<Bitmask, Bitmask>> data;
+    vector<OutShare> out_hws;
+    for (const size_t bm_bits : bm_bitsizes) {
+      const size_t bytelen = bitbytes(bm_bits);
+      const auto random_bitmasks = [&]() {
+        Bitmask bms(bytelen * nvals);
+        for (auto& byte : bms) byte = random_byte(gen);
+        // Clear unused bits of each bitmask's last byte
+        if (bm_bits % 8) {
+          for (size_t i = 0; i != nvals; ++i) {
+            bms[(i+1)*bytelen - 1] &= (1u << (bm_bits % 8)) - 1;
+          }
+        }
+        return bms;
+      };
+      data.emplace_back(random_bitmasks(), random_bitmasks());
+      const auto& [bm, bm2] = data.back();
+
+      BoolShare in, in2;
+      if (role==CLIENT) {
+        in = BoolShare{bc, bm.data(), (uint32_t)bm_bits, CLIENT, nvals};
+        in2 = BoolShare{bc, (uint32_t)bm_bits, nvals};
+      } else {
+        in2 = BoolShare{bc, bm2.data(), (uint32_t)bm_bits, SERVER, nvals};
+        in = BoolShare{bc, (uint32_t)bm_bits, nvals};
+      }
+      BoolShare low_depth_hw = low_depth_hammingweight(in & in2);
+      print_share(low_depth_hw, format("{} bit low-depth hw", bm_bits));
+      out_hws.push_back(out(low_depth_hw, ALL));
+    }
+
+    party.ExecCircuit();
+
+    for (size_t b = 0; b != bm_bitsizes.size(); ++b) {
+      const size_t bytelen = bitbytes(bm_bitsizes[b]);
+      const auto& [bm, bm2] = data[b];
+      const auto res = out_hws[b].get_clear_value_vec();
+      for (size_t i = 0; i != nvals; ++i) {
+        uint32_t expected = 0;
+        for (size_t j = i*bytelen; j != (i+1)*bytelen; ++j) {
+          expected += __builtin_popcount(bm[j] & bm2[j]);
+        }
+        print("{} bit low-depth hw: {} (expected {}){}\n", bm_bitsizes[b],
+            res[i], expected, res[i] == expected ? "" : " MISMATCH");
+      }
+    }
   }
 
   void test_split_accumulate() {
@@ -359,6 +429,72 @@ struct ABYTester {
     party.ExecCircuit();
   }
 
+  /**
+   * Folds nsegments interleaved segments of nvals values each, i.e., value
+   * j*nsegments + s belongs to segment s. If contiguous, the segments are
+   * concatenated instead, i.e., value s*nvals + j belongs to segment s.
+   */
+  template <class MultShare>
+  void test_segmented_quotient_folder(size_t nsegments, bool contiguous = false) {
+    auto circ = circuit<MultShare>();
+    size_t num_bits = llround(2*((double)(bitlen)/3));
+    size_t den_bits = llround((double)(bitlen)/3);
+    const size_t total_nvals = nvals * nsegments;
+    vector<uint64_t> data_num, data_den;
+    for (size_t s = 0; s != nsegments; ++s) {
+      auto seg_num = make_random_vector(num_bits);
+      auto seg_den = make_random_vector(den_bits);
+      data_num.insert(data_num.end(), seg_num.begin(), seg_num.end());
+      data_den.insert(data_den.end(), seg_den.begin(), seg_den.end());
+    }
+    // interleave segments, unless contiguous
+    vector<uint64_t> in_num(total_nvals), in_den(total_nvals);
+    for (size_t s = 0; s != nsegments; ++s) {
+      uint64_t max_num = 0, max_den = 1;
+      size_t max_idx = numeric_limits<size_t>::max();
+      for (size_t i = 0; i != nvals; ++i) {
+        auto num = data_num[s*nvals + i], den = data_den[s*nvals + i];
+        const size_t k = contiguous ? s*nvals + i : i*nsegments + s;
+        in_num[k] = num;
+        in_den[k] = den;
+        if (den == 0) continue;
+        if ( (num * max_den > max_num * den)
+            or ( (num * max_den == max_num * den) and (den > max_den) )
+           ) {
+          max_den = den, max_num = num;
+          max_idx = i;
+        }
+      }
+      print("Segment {}: Maximum num: {}, den: {}, index: {}\n",
+          s, max_num, max_den, max_idx);
+    }
+
+    Quotient<MultShare> inq = {
+      {circ, in_num.data(), bitlen, SERVER, (uint32_t)total_nvals},
+      {circ, in_den.data(), bitlen, CLIENT, (uint32_t)total_nvals}
+    };
+
+    using QF = QuotientFolder<MultShare>;
+
+    vector<BoolShare> targets = {contiguous ?
+      vcombine(vector<BoolShare>(nsegments, ascending_numbers_constant(bc, nvals)))
+      : ascending_numbers_constant(bc, nvals, 0, nsegments)};
+
+    QF folder(move(inq), QF::FoldOp::MAX_TIE, move(targets));
+    if constexpr (std::is_same_v<MultShare, ArithShare>) {
+      folder.set_converters_and_den_bits(&to_bool_closure, &to_arith_closure, den_bits);
+    }
+    folder.set_segments(nsegments, contiguous ?
+        QF::SegmentLayout::CONTIGUOUS : QF::SegmentLayout::INTERLEAVED);
+    auto res = folder.fold();
+
+    print_share(res.get_selector().num, "max nums");
+    print_share(res.get_selector().den, "max dens");
+    print_share(res.get_targets()[0], "indices of max");
+
+    party.ExecCircuit();
+  }
+
 
   void test_add() {
     constexpr uint32_t _bitlen = 8;
@@ -379,6 +515,42 @@ struct ABYTester {
 
     cout << "a+b: " << out_ab.get_clear_value<uint32_t>() << endl;
   }
+
+  /**
+   * Runs the cached sel_int_div circuit twice on random x <= y and compares
+   * with the rounding integer division ((x<<prec) + (y>>1)) / y
+   */
+  void test_int_div(uint32_t prec = 10) {
+    constexpr uint32_t div_bitlen = 8;
+    const string fn = fmt::format("../data/circ/sel_int_div/{}_{}.aby", div_bitlen, prec);
+    vector<uint64_t> xs = make_random_vector(div_bitlen-1),
+      ys = make_random_vector(div_bitlen-1);
+    for (size_t i = 0; i != nvals; ++i) {
+      if (xs[i] > ys[i]) swap(xs[i], ys[i]);
+      if (ys[i] == 0) xs[i] = ys[i] = 1;
+    }
+
+    BoolShare x = (role==SERVER) ? BoolShare{bc, div_bitlen, nvals}
+      : BoolShare{bc, xs.data(), div_bitlen, CLIENT, nvals};
+    BoolShare y = (role==CLIENT) ? BoolShare{bc, div_bitlen, nvals}
+      : BoolShare{bc, ys.data(), div_bitlen, SERVER, nvals};
+
+    // second application is instantiated from the in-memory circuit
+    BoolShare q1 = apply_file_binary(x, y, div_bitlen, div_bitlen, fn);
+    BoolShare q2 = apply_file_binary(x, y, div_bitlen, div_bitlen, fn);
+    OutShare out_q1 = out(q1, ALL), out_q2 = out(q2, ALL);
+
+    party.ExecCircuit();
+
+    const auto res1 = out_q1.get_clear_value_vec();
+    const auto res2 = out_q2.get_clear_value_vec();
+    for (size_t i = 0; i != nvals; ++i) {
+      const uint64_t expected = ((xs[i] << prec) + (ys[i] >> 1)) / ys[i];
+      const bool ok = res1[i] == expected && res2[i] == expected;
+      print("{}/{}: {} | {} (expected {}){}\n", xs[i], ys[i], res1[i], res2[i],
+          expected, ok ? "" : " MISMATCH");
+    }
+  }
 };
 
 int main(int argc, char *argv[])
@@ -413,13 +585,17 @@ int main(int argc, char *argv[])
 
   //tester.test_split_select_target();
   //tester.test_add();
+  //tester.test_int_div();
   //tester.test_mult_const();
   //tester.test_hw();
+  //tester.test_bitmask_hw();
   //tester.test_max_bits();
   //tester.test_conversion();
   //tester.test_reinterpret();
   //tester.test_split_accumulate();
   tester.test_quotient_folder<BoolShare>();
+  //tester.test_segmented_quotient_folder<BoolShare>(3);
+  //tester.test_segmented_quotient_folder<BoolShare>(3, true);
   //tester.test_max_quotient();
   //tester.test_bm_input();
   //tester.test_deterministic_aby_chaos();
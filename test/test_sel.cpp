@@ -27,6 +27,14 @@ bool only_local{false};
 MPCRole role;
 BooleanSharing sharing;
 bool use_conversion{false};
+bool auto_sharing{false};
+bool batch_records{false};
+bool division_free_dice{false};
+size_t database_chunk_size{0};
+size_t greedy_exchange_group_size{0};
+size_t dice_precision{0}, weight_precision{0};
+bool arith_hammingweight{false};
+size_t bitmask_size{500};
 bool print_table{false};
 int bitmask_density_shift{0};
 
@@ -102,7 +110,7 @@ EpilinkConfig make_benchmark_cfg(size_t num_fields, RunMode mode) {
     if (mode == RunMode::bitmask || mode == RunMode::combined) {
       if (mode == RunMode::combined)
         fieldname += "b";
-      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "dice", "bitmask", 500);
+      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "dice", "bitmask", bitmask_size);
     }
   }
   EpilinkConfig cfg(field_config,{},Threshold, TThreshold);
@@ -226,6 +234,52 @@ EpilinkInput input_exchange_grp(uint32_t dbsize) {
   return {move(epi_cfg), move(in_client), move(in_server)};
 }
 
+/**
+ * Exchange group of five dice fields of different weights, in which most
+ * pairs have a zero score. Only client field g0 and server fields g0, g3
+ * overlap, so greedy assignment (-G) has to break ties between zero-score
+ * pairs of different weights in most rounds.
+ */
+EpilinkInput input_zero_score_group(uint32_t dbsize) {
+  map<string, FieldSpec> fields;
+  vector<string> group;
+  for (size_t i = 0; i != 5; ++i) {
+    string name{"g" + to_string(i)};
+    fields.emplace(name, FieldSpec{name, 1.0 + i, BM, FieldType::BITMASK, 8});
+    group.emplace_back(move(name));
+  }
+
+  EpilinkConfig epi_cfg {
+    move(fields),
+    {IndexSet{group.cbegin(), group.cend()}}, // exchange groups
+    Threshold, TThreshold // (tent.) thresholds
+  };
+
+  EpilinkClientInput in_client {
+    {
+      {"g0", Bitmask{0x0f}},
+      {"g1", Bitmask{0xf0}},
+      {"g2", Bitmask{0xf0}},
+      {"g3", Bitmask{0xf0}},
+      {"g4", Bitmask{0xf0}}
+    }, // record
+    dbsize // dbsize
+  };
+
+  EpilinkServerInput in_server {
+    {
+      {"g0", vector<FieldEntry>(dbsize, Bitmask{0x03})},
+      {"g1", vector<FieldEntry>(dbsize, Bitmask{0x01})},
+      {"g2", vector<FieldEntry>(dbsize, Bitmask{0x02})},
+      {"g3", vector<FieldEntry>(dbsize, Bitmask{0x07})},
+      {"g4", vector<FieldEntry>(dbsize, Bitmask{0x08})}
+    }, // db
+    1 // num_records
+  };
+
+  return {move(epi_cfg), move(in_client), move(in_server)};
+}
+
 EpilinkInput input_empty() {
   auto td = make_test_data();
   auto& f_bm1 = td["bm_1"].field;
@@ -278,7 +332,8 @@ EpilinkInput generate_modal_epilink_input(size_t dbsize, size_t nrecords, size_t
     case 1: return input_benchmark_random(dbsize, nrecords, num_fields, RunMode::integer);
     case 2: return input_benchmark_random(dbsize, nrecords, num_fields, RunMode::bitmask);
     case 3: return input_benchmark_random(dbsize, nrecords, num_fields, RunMode::combined);
-    default: throw std::runtime_error("Wrong mode of operation! Use 0,1,2 or 3");
+    case 4: return input_zero_score_group(dbsize);
+    default: throw std::runtime_error("Wrong mode of operation! Use 0,1,2,3 or 4");
   }
 }
 
@@ -396,7 +451,17 @@ CircuitConfig make_circuit_config(const EpilinkConfig& cfg) {
   if constexpr (is_integral_v<T>) {
     bitlen = sizeof(T)*8;
   }
-  return {cfg, CircDir, true, sharing, use_conversion, bitlen};
+  CircuitConfig circ_cfg{cfg, CircDir, true, sharing, use_conversion, bitlen};
+  circ_cfg.auto_sharing = auto_sharing;
+  circ_cfg.batch_records = batch_records;
+  if (division_free_dice) circ_cfg.set_division_free_dice();
+  circ_cfg.database_chunk_size = database_chunk_size;
+  circ_cfg.greedy_exchange_group_size = greedy_exchange_group_size;
+  circ_cfg.set_arith_hammingweight(arith_hammingweight);
+  if (dice_precision || weight_precision) {
+    circ_cfg.fit_bitlen(dice_precision, weight_precision);
+  }
+  return circ_cfg;
 }
 
 template <typename T>
@@ -459,6 +524,9 @@ bool run_and_print_linkage(SecureEpilinker& linker, const EpilinkInput& in) {
     print_local_result(outputss, resp, results_32[i], "32 Bit");
     print_local_result(outputss, resp, results_64[i], "64 Bit");
     print_local_result(outputss, resp, results_double[i], "Double");
+    print(outputss, "32 Bit{} deviation from exact score: {:+.3f}%\n",
+        division_free_dice ? " division-free" : "",
+        deviation_perc(results_double[i], results_32[i]));
   }
 
   if (all_good) {
@@ -471,7 +539,12 @@ bool run_and_print_linkage(SecureEpilinker& linker, const EpilinkInput& in) {
   return all_good;
 }
 
-void run_and_print_counting(SecureEpilinker& linker, const EpilinkInput& in) {
+/**
+ * Runs the counting circuit and prints its counts next to the clear
+ * calculations. Returns whether the counts agree with the 32 bit clear
+ * calculation, like run_and_print_linkage() compares the results.
+ */
+bool run_and_print_counting(SecureEpilinker& linker, const EpilinkInput& in) {
   vector<pair<string, CountResult<size_t>>> results;
   stringstream outputss;
   outputss << "Counting Results:\n";
@@ -497,6 +570,9 @@ void run_and_print_counting(SecureEpilinker& linker, const EpilinkInput& in) {
     outputss << '\t' << test_str(good);
   }
   logger->info(outputss.str());
+  if (only_local) return true;
+  const auto& sel = results[0].second, & local_32 = results[1].second;
+  return sel.matches == local_32.matches && sel.tmatches == local_32.tmatches;
 }
 
 template <typename T>
@@ -554,15 +630,34 @@ int main(int argc, char *argv[])
     ("s,sharing", "Boolean sharing to use. 0: GMW, 1: YAO (default)", cxxopts::value(sharing_num))
     ("c,conversion", "Whether to convert to arithmetic space for multiplications",
         cxxopts::value(use_conversion))
+    ("A,auto-sharing", "Choose sharing and conversion by predicted runtime, "
+        "ignoring -s and -c", cxxopts::value(auto_sharing))
     ("n,dbsize", "Database size", cxxopts::value(dbsize))
     ("N,nrecords", "Number of client records", cxxopts::value(nrecords))
+    ("b,batch", "Evaluate all client records in a single batched circuit",
+        cxxopts::value(batch_records))
+    ("D,division-free", "Use division-free dice coefficients",
+        cxxopts::value(division_free_dice))
+    ("C,chunk-size", "Stream the database in chunks of this size. 0: no streaming (default)",
+        cxxopts::value(database_chunk_size))
+    ("G,greedy-groups", "Assign exchange groups of at least this size greedily. 0: never (default)",
+        cxxopts::value(greedy_exchange_group_size))
+    ("dice-prec", "Dice precision. Together with --weight-prec, runs on the "
+        "smallest arithmetic ring fitting both. Needs both or neither",
+        cxxopts::value(dice_precision))
+    ("weight-prec", "Weight precision, see --dice-prec", cxxopts::value(weight_precision))
+    ("arith-hw", "Compute division-free dice numerators in arithmetic space "
+        "by per-bit conversion (with -c -D)", cxxopts::value(arith_hammingweight))
     ("R,run-both", "Use set_both_inputs()", cxxopts::value(run_both))
     ("L,local-only", "Only run local calculations on clear values."
         " Doesn't initialize the SecureEpilinker.", cxxopts::value(only_local))
     ("m,match-count", "Run match counting instead of linkage.", cxxopts::value(match_counting))
     ("M,mode", "Select test mode: (0) dkfz config, (1) integer fields,"
-        " (2) bitfield fields, (3) combined fields", cxxopts::value(mode))
+        " (2) bitfield fields, (3) combined fields, (4) exchange group with"
+        " zero-score pairs, e.g., with -G 2", cxxopts::value(mode))
     ("num-fields", "Number of fields to generate in modes 1,2 and 3", cxxopts::value(num_fields))
+    ("bitmask-size", "Bitsize of bitmask fields in modes 2 and 3. Default 500",
+        cxxopts::value(bitmask_size))
     ("bm-density-shift", "Bitmask density shift during generation of random "
         "inputs: 0: equal number of 1s and 0s; >0: more 1s; <0: more 0s.",
         cxxopts::value(bitmask_density_shift))
@@ -608,11 +703,9 @@ int main(int argc, char *argv[])
   const auto circ_cfg = make_circuit_config<CircUnit>(in.cfg);
   SecureEpilinker linker{aby_cfg, circ_cfg};
   if(!only_local) linker.connect();
-  /* in counting mode, we don't really know if the calculations are correct, as
-   * we cannot compare the scores directly. So we default to true. */
-  bool correct = true;
-  if(match_counting) run_and_print_counting(linker, in);
-  else correct = run_and_print_linkage(linker, in);
+  // in counting mode, we can only compare the counts, not the scores
+  const bool correct = match_counting ? run_and_print_counting(linker, in)
+    : run_and_print_linkage(linker, in);
 
 #ifdef SEL_STATS
   if (!benchmark_filepath.empty()) {
@@ -623,6 +716,10 @@ int main(int argc, char *argv[])
     print_toml(bfile, "mode", match_counting ? "\"count\"" : "\"linkage\"");
     print_toml(bfile, "boolSharing", sharing_num ? "\"yao\"" : "\"bool\"");
     print_toml(bfile, "arithConversion", use_conversion);
+    print_toml(bfile, "autoSharing", auto_sharing);
+    print_toml(bfile, "bitlen", circ_cfg.bitlen);
+    print_toml(bfile, "arithHammingweight", arith_hammingweight);
+    print_toml(bfile, "bitmaskSize", bitmask_size);
     print_toml(bfile, "dbSize", dbsize);
     print_toml(bfile, "numRecords", nrecords);
 
@@ -32,6 +32,24 @@ void test_ceil_log2() {
   }
 }
 
+void test_hw() {
+  // Cover full 64-byte blocks, 64-bit words and trailing bytes
+  for (size_t size = 0; size != 200; ++size) {
+    Bitmask left(size), right(size);
+    for (size_t i = 0; i != size; ++i) {
+      left[i] = (i * 37 + size) & 0xff;
+      right[i] = (i * 101 + 7) & 0xff;
+    }
+    size_t left_hw = 0, and_hw = 0;
+    for (size_t i = 0; i != size; ++i) {
+      left_hw += __builtin_popcount(left[i]);
+      and_hw += __builtin_popcount(left[i] & right[i]);
+    }
+    assert (hw(left) == left_hw);
+    assert (bm_and_hw(left.data(), right.data(), size) == and_hw);
+  }
+}
+
 void test_map() {
   map<int, double> nums{{0,3.4}, {1,4.1}, {2,16.9}};
   auto numsi = transform_map(nums, [](double x){
@@ -56,6 +74,7 @@ int main(int argc, char *argv[])
 {
   test_vector_bool_to_bitmask();
   test_ceil_log2();
+  test_hw();
   test_map();
   test_format_vector();
   return 0;